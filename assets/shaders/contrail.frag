@@ -0,0 +1,11 @@
+#version 330 core
+in vec4 TrailColor;
+in float Across;
+out vec4 FragColor;
+
+void main()
+{
+    // Soft edges across the ribbon
+    float edge = 1.0 - Across * Across;
+    FragColor = vec4(TrailColor.rgb, TrailColor.a * edge);
+}
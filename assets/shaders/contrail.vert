@@ -0,0 +1,45 @@
+#version 330 core
+// Expands one engine's ring of contrail samples into a camera-facing triangle strip.
+// Vertices 2i and 2i+1 are the two edges of the ribbon at the sample i steps behind the newest.
+#include "frame_data.glsl"
+out vec4 TrailColor;
+out float Across;   // -1 .. 1 across the ribbon
+
+uniform samplerBuffer samples;   // vec4: position, birth time
+uniform int base;                // first sample of this engine's ring
+uniform int ringSize;
+uniform int head;                // newest sample, relative to base
+uniform int count;               // valid samples in the ring
+
+uniform float trailTime;         // Contrails' clock, which sample birth times are on
+uniform float lifetime;
+uniform float startWidth;
+uniform float endWidth;
+uniform vec4 trailColor;
+
+vec4 Sample(int age) {
+    age = clamp(age, 0, count - 1);
+    return texelFetch(samples, base + (head - age + ringSize) % ringSize);
+}
+
+void main()
+{
+    int age = gl_VertexID >> 1;
+    float side = ((gl_VertexID & 1) == 0) ? -1.0 : 1.0;
+    vec4 s = Sample(age);
+
+    // Along the trail from the neighbouring samples, across it facing the camera
+    vec3 along = Sample(age - 1).xyz - Sample(age + 1).xyz;
+    vec3 across = cross(along, followCameraPos.xyz - s.xyz);
+    float acrossLength = length(across);
+    across = (acrossLength > 1e-5) ? across / acrossLength : vec3(0.0);
+
+    float t = clamp((trailTime - s.w) / lifetime, 0.0, 1.0);
+    float width = mix(startWidth, endWidth, sqrt(t));
+    gl_Position = projection * followView * vec4(s.xyz + across * (0.5 * width * side), 1.0);
+
+    // Condenses a moment behind the engine, then fades as it spreads
+    float fade = (1.0 - t) * (1.0 - t) * smoothstep(0.0, 0.1, trailTime - s.w);
+    TrailColor = vec4(trailColor.rgb, trailColor.a * fade);
+    Across = side;
+}
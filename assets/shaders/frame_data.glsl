@@ -0,0 +1,13 @@
+// Per-frame values shared by every program, uploaded once per frame by FrameUniforms.
+// std140; must match FrameData in src/graphics/FrameUniforms.h
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 cameraView;        // fly camera: terrain, stars
+    mat4 followView;        // chase camera behind the plane: plane, particles, contrails
+    vec4 cameraPos;
+    vec4 followCameraPos;
+    vec4 lightPos;
+    vec4 lightColor;
+    float time;
+    float pointScale;
+};
@@ -1,17 +1,15 @@
 #version 330 core
+#include "frame_data.glsl"
 out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
-in vec3 VertexColor;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform vec3 lightColor;
-uniform float iTime;
 uniform sampler2D snowTex;
 uniform sampler2D rockTex;
 uniform sampler2D waterTex;
+uniform float fogStart;     // set by InfiniteTerrain::Draw from its visible radius
+uniform float fogEnd;
 
 void main() {
     vec3 norm = normalize(Normal);
@@ -23,20 +21,20 @@ void main() {
     ambient *= 0.7;
 
     // Diffuse
-    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * lightColor.rgb;
 
     // Specular
     float specularStrength = 0.12;
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(cameraPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 24);
-    vec3 specular = specularStrength * spec * lightColor;
+    vec3 specular = specularStrength * spec * lightColor.rgb;
 
     // Distance fog
-    float distance = length(viewPos - FragPos);
-    float fogFactor = clamp(1.0 - (distance - 500.0) / 1500.0, 0.0, 1.0);
+    float distance = length(cameraPos.xyz - FragPos);
+    float fogFactor = clamp(1.0 - (distance - fogStart) / max(fogEnd - fogStart, 1.0), 0.0, 1.0);
     vec3 fogColor = vec3(0.7, 0.8, 0.9);
 
     // Texture sampling
@@ -1,19 +1,25 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec3 aColor;
+#include "frame_data.glsl"
+// Packed terrain vertex: offset from the chunk origin, height, normal x/z (snorm16)
+layout (location = 0) in vec2 aLocalPos;
+layout (location = 1) in float aHeight;
+layout (location = 2) in vec2 aNormalXZ;
 
 out vec3 FragPos;
 out vec3 Normal;
-out vec3 VertexColor;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per pool slot: origin x, origin z, node size. Terrain is submitted with a single
+// glMultiDrawElementsBaseVertex, and gl_VertexID includes basevertex = slot * verticesPerChunk.
+uniform samplerBuffer chunkInfo;
+uniform int verticesPerChunk;
 
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    VertexColor = aColor;
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    vec2 chunkOrigin = texelFetch(chunkInfo, gl_VertexID / verticesPerChunk).xy;
+    vec3 localPos = vec3(chunkOrigin.x + aLocalPos.x, aHeight, chunkOrigin.y + aLocalPos.y);
+    // Heightfield normals always point up, so y is rebuilt from x/z
+    vec3 normal = vec3(aNormalXZ.x, sqrt(max(1.0 - dot(aNormalXZ, aNormalXZ), 0.0)), aNormalXZ.y);
+    FragPos = vec3(model * vec4(localPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = projection * cameraView * vec4(FragPos, 1.0);
 }
@@ -0,0 +1,37 @@
+#version 330 core
+#include "frame_data.glsl"
+// GPU heightmap terrain: one flat grid mesh drawn instanced, one instance per visible node.
+// Heights come from the node's layer of heightTiles (baked by terrain_height_bake.frag) and
+// normals from central differences over the tile border. Outputs match infinite_terrain.vert,
+// so both paths share infinite_terrain.frag.
+layout (location = 0) in vec3 aGrid;   // grid x, grid z, 1.0 on skirt vertices
+layout (location = 1) in int aSlot;    // per instance: height layer and chunkInfo index
+
+out vec3 FragPos;
+out vec3 Normal;
+
+uniform mat4 model;
+// Per slot: origin x, origin z, node size, skirt depth
+uniform samplerBuffer chunkInfo;
+uniform sampler2DArray heightTiles;
+uniform int gridSize;
+
+float tileHeight(ivec2 texel) {
+    return texelFetch(heightTiles, ivec3(texel, aSlot), 0).r;
+}
+
+void main() {
+    vec4 info = texelFetch(chunkInfo, aSlot);
+    float spacing = info.z / float(gridSize);
+    ivec2 texel = ivec2(aGrid.xy) + 1;
+    
+    float height = tileHeight(texel) - aGrid.z * info.w;
+    float dHdx = (tileHeight(texel + ivec2(1, 0)) - tileHeight(texel - ivec2(1, 0))) / (2.0 * spacing);
+    float dHdz = (tileHeight(texel + ivec2(0, 1)) - tileHeight(texel - ivec2(0, 1))) / (2.0 * spacing);
+    vec3 normal = normalize(vec3(-dHdx, 1.0, -dHdz));
+    
+    vec3 localPos = vec3(info.x + aGrid.x * spacing, height, info.y + aGrid.y * spacing);
+    FragPos = vec3(model * vec4(localPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = projection * cameraView * vec4(FragPos, 1.0);
+}
@@ -1,16 +1,40 @@
 #version 330 core
+#include "frame_data.glsl"
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec4 aColor;
 layout (location = 2) in float aSize;
 
 out vec4 ParticleColor;
 
-uniform mat4 view;
-uniform mat4 projection;
+
+// WeatherVolume: aPos is a seed in [0,1)^3 and aSize a variation in [0,1). The point is placed
+// in a box of volumeSize centred on the camera, shifted by volumeShift and wrapped, so the
+// box repeats endlessly as the camera moves and the weather scrolls.
+uniform bool wrapVolume;
+uniform vec3 volumeSize;
+uniform vec3 volumeShift;
+uniform float swayPhase;
+uniform float swayAmount;
+uniform vec4 weatherColor;
+uniform float weatherPointSize;
 
 void main()
 {
-    gl_Position = projection * view * vec4(aPos, 1.0);
-    gl_PointSize = aSize;
+    if (wrapVolume) {
+        vec3 p = aPos * volumeSize + volumeShift;
+        float phase = swayPhase + aSize * 6.2831853;
+        p.xz += vec2(sin(phase), cos(phase * 0.7)) * swayAmount;
+        vec3 halfSize = 0.5 * volumeSize;
+        vec3 local = mod(p, volumeSize) - halfSize;
+        // Fade out towards the faces so points wrapping across them do not pop
+        vec3 edge = abs(local) / halfSize;
+        float fade = 1.0 - smoothstep(0.8, 1.0, max(max(edge.x, edge.y), edge.z));
+        gl_Position = projection * followView * vec4(followCameraPos.xyz + local, 1.0);
+        gl_PointSize = max(1.0, weatherPointSize * (0.75 + 0.5 * aSize) * pointScale);
+        ParticleColor = vec4(weatherColor.rgb, weatherColor.a * fade);
+        return;
+    }
+    gl_Position = projection * followView * vec4(aPos, 1.0);
+    gl_PointSize = max(1.0, aSize * pointScale);
     ParticleColor = aColor;
 }
@@ -0,0 +1,45 @@
+#version 330 core
+// Upsamples the low-resolution particle target (premultiplied colour, coverage alpha) over the
+// scene. Where the four low-resolution texels around a pixel all lie at about the pixel's own
+// depth the colour is filtered bilinearly; across a depth edge the texel whose depth is nearest
+// to the pixel's is used instead, so particles do not bleed onto or off geometry silhouettes.
+out vec4 FragColor;
+
+uniform sampler2D particleColor;
+uniform sampler2D particleDepth;   // low-resolution depth the particles were tested against
+uniform sampler2D sceneDepth;      // full-resolution scene depth
+uniform float nearPlane;
+uniform float farPlane;
+uniform float edgeThreshold;       // relative linear depth difference treated as an edge
+
+float LinearDepth(float d) {
+    return nearPlane * farPlane / (farPlane - d * (farPlane - nearPlane));
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec2 lowSize = vec2(textureSize(particleColor, 0));
+    vec2 fullSize = vec2(textureSize(sceneDepth, 0));
+    vec2 uv = gl_FragCoord.xy / fullSize;
+    float depth = LinearDepth(texelFetch(sceneDepth, pixel, 0).r);
+
+    // The four low-resolution texels bilinear filtering would blend
+    vec2 p = uv * lowSize - 0.5;
+    ivec2 base = ivec2(floor(p));
+    ivec2 maxTexel = ivec2(lowSize) - 1;
+    ivec2 texels[4] = ivec2[4](base, base + ivec2(1, 0), base + ivec2(0, 1), base + ivec2(1, 1));
+    float bestDifference = 1e30;
+    ivec2 bestTexel = clamp(base, ivec2(0), maxTexel);
+    bool edge = false;
+    for (int i = 0; i < 4; ++i) {
+        ivec2 t = clamp(texels[i], ivec2(0), maxTexel);
+        float difference = abs(LinearDepth(texelFetch(particleDepth, t, 0).r) - depth);
+        edge = edge || difference > edgeThreshold * depth;
+        if (difference < bestDifference) {
+            bestDifference = difference;
+            bestTexel = t;
+        }
+    }
+
+    FragColor = edge ? texelFetch(particleColor, bestTexel, 0) : texture(particleColor, uv);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+// Writes the nearest scene depth of each divisor x divisor block into the low-resolution depth
+// target. Nearest keeps particles from being drawn over geometry edges; the pixels of the block
+// that lie behind the edge are filled in by the composite's nearest-depth upsample.
+uniform sampler2D sceneDepth;
+uniform int divisor;
+
+void main() {
+    ivec2 base = ivec2(gl_FragCoord.xy) * divisor;
+    ivec2 maxTexel = textureSize(sceneDepth, 0) - 1;
+    float nearest = 1.0;
+    for (int y = 0; y < divisor; ++y) {
+        for (int x = 0; x < divisor; ++x) {
+            nearest = min(nearest, texelFetch(sceneDepth, min(base + ivec2(x, y), maxTexel), 0).r);
+        }
+    }
+    gl_FragDepth = nearest;
+}
@@ -0,0 +1,31 @@
+#version 330 core
+// Draws ParticleSystem's GPU state buffer directly; colour and size follow the CPU path's
+// ParticleStyle. Dead slots are moved outside the clip volume. A negative size marks a splash,
+// which fades over splashLife instead of lifetime.
+#include "frame_data.glsl"
+layout (location = 0) in vec4 aPositionLife;
+layout (location = 1) in vec4 aVelocitySize;
+
+out vec4 ParticleColor;
+
+uniform vec4 particleColor;
+uniform float lifetime;
+uniform float alphaScale;
+uniform float sizeGrowth;
+uniform float splashLife;
+
+void main()
+{
+    float life = aPositionLife.w;
+    if (life <= 0.0) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_PointSize = 1.0;
+        ParticleColor = vec4(0.0);
+        return;
+    }
+    float size = abs(aVelocitySize.w);
+    float lifeRatio = life / (aVelocitySize.w < 0.0 ? splashLife : lifetime);
+    gl_Position = projection * followView * vec4(aPositionLife.xyz, 1.0);
+    gl_PointSize = max(1.0, size * (1.0 + (1.0 - lifeRatio) * sizeGrowth) * pointScale);
+    ParticleColor = vec4(particleColor.rgb, min(1.0, lifeRatio * alphaScale));
+}
@@ -0,0 +1,110 @@
+#version 330 core
+// Transform feedback pass of ParticleSystem's GPU simulation: one vertex per particle slot,
+// read from one state buffer and written to the other. Mirrors the CPU integration in
+// ParticleSystem.cpp. Dead slots inside this frame's emission window respawn inside their
+// emitter's box; the window is a ring over the slots that advances by the emitted count.
+// Ground collision projects each particle into a copy of the scene depth buffer: a particle
+// just behind the stored surface has hit it and is removed or becomes a splash (negative size).
+layout (location = 0) in vec4 aPositionLife;
+layout (location = 1) in vec4 aVelocitySize;
+
+out vec4 outPositionLife;
+out vec4 outVelocitySize;
+
+const int MAX_EMITTERS = 8;   // ParticleSystem::MaxGpuEmitters
+
+uniform float deltaTime;
+uniform vec3 gravity;
+uniform float sway;           // snow drift amplitude, 0 for none
+uniform float lifetime;
+uniform float particleSize;
+uniform float spread;         // random velocity added per axis, +-spread
+
+uniform int capacity;
+uniform int emitStart;        // first slot of the emission window
+uniform int emitterCount;
+uniform int emitEnd[MAX_EMITTERS];          // cumulative particle counts
+uniform vec3 emitCenter[MAX_EMITTERS];
+uniform vec3 emitHalfExtent[MAX_EMITTERS];
+uniform vec3 emitVelocity[MAX_EMITTERS];
+uniform int seed;             // changes every frame (uint bits; Shader has no unsigned setter)
+
+uniform int collisionMode;    // ParticleCollision: 0 none, 1 kill, 2 splash
+uniform sampler2D sceneDepth;
+uniform mat4 collisionViewProjection;   // what sceneDepth was rendered with
+uniform float nearPlane;
+uniform float farPlane;
+uniform float splashLife;
+
+// Particles further behind the surface than this (world units) are hidden by it, not hitting it
+const float COLLISION_THICKNESS = 4.0;
+
+// PCG output permutation, as in NoiseFbm.h
+uint pcg(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random11(inout uint state) {
+    state = pcg(state);
+    return float(state >> 8u) * (2.0 / 16777216.0) - 1.0;
+}
+
+float LinearDepth(float d) {
+    return nearPlane * farPlane / (farPlane - d * (farPlane - nearPlane));
+}
+
+bool BehindSurface(vec3 position) {
+    vec4 clip = collisionViewProjection * vec4(position, 1.0);
+    if (clip.w <= 0.0) return false;
+    vec3 ndc = clip.xyz / clip.w;
+    if (any(greaterThan(abs(ndc), vec3(1.0)))) return false;
+    float surface = LinearDepth(textureLod(sceneDepth, ndc.xy * 0.5 + 0.5, 0.0).r);
+    float behind = LinearDepth(ndc.z * 0.5 + 0.5) - surface;
+    return behind > 0.0 && behind < COLLISION_THICKNESS;
+}
+
+void main()
+{
+    vec3 position = aPositionLife.xyz;
+    float life = aPositionLife.w;
+    vec3 velocity = aVelocitySize.xyz;
+    float size = aVelocitySize.w;
+
+    if (life > 0.0) {
+        life -= deltaTime;
+        velocity += gravity * deltaTime;
+        position += velocity * deltaTime;
+        velocity.x += sin(life * 3.0) * sway * deltaTime;
+        velocity.z += cos(life * 2.5) * sway * deltaTime;
+        if (collisionMode != 0 && life > 0.0 && BehindSurface(position)) {
+            if (collisionMode == 1 || size < 0.0) {
+                // Splashes that land again are removed
+                life = 0.0;
+            } else {
+                uint state = pcg(uint(gl_VertexID) + pcg(uint(seed)));
+                position = aPositionLife.xyz;
+                velocity = vec3(velocity.x * 0.2 + random11(state) * 1.5, 3.0, velocity.z * 0.2 + random11(state) * 1.5);
+                life = splashLife;
+                size = -0.75 * size;
+            }
+        }
+    } else if (emitterCount > 0) {
+        int offset = (gl_VertexID - emitStart + capacity) % capacity;
+        if (offset < emitEnd[emitterCount - 1]) {
+            int k = 0;
+            while (k < emitterCount - 1 && offset >= emitEnd[k]) k++;
+            uint state = pcg(uint(gl_VertexID) + pcg(uint(seed)));
+            vec3 r = vec3(random11(state), random11(state), random11(state));
+            vec3 s = vec3(random11(state), random11(state), random11(state));
+            position = emitCenter[k] + emitHalfExtent[k] * r;
+            velocity = emitVelocity[k] + s * spread;
+            life = lifetime;
+            size = particleSize;
+        }
+    }
+
+    outPositionLife = vec4(position, life);
+    outVelocitySize = vec4(velocity, size);
+}
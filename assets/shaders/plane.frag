@@ -1,13 +1,13 @@
 #version 330 core
+#include "frame_data.glsl"
 out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec3 LocalPos;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform vec3 lightColor;
+// The plane keeps a fixed sun colour rather than FrameData.lightColor
+uniform vec3 planeLightColor;
 
 void main() {
     // Multi-color fighter jet based on local position
@@ -40,20 +40,20 @@ void main() {
     
     // Ambient
     float ambientStrength = 0.3;
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = ambientStrength * planeLightColor;
     
     // Diffuse
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * planeLightColor;
     
     // Specular (metallic look)
     float specularStrength = 0.5;
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(followCameraPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * lightColor;
+    vec3 specular = specularStrength * spec * planeLightColor;
     
     vec3 result = (ambient + diffuse + specular) * objectColor;
     FragColor = vec4(result, 1.0);
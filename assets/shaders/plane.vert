@@ -1,4 +1,5 @@
 #version 330 core
+#include "frame_data.glsl"
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 
@@ -7,12 +8,10 @@ out vec3 Normal;
 out vec3 LocalPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main() {
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;
     LocalPos = aPos; // Pass local position for coloring
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = projection * followView * vec4(FragPos, 1.0);
 }
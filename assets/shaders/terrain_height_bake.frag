@@ -0,0 +1,65 @@
+#version 330 core
+// Bakes one terrain node into a layer of the height texture array (R32F).
+// Port of TerrainNoise::Fbm with the IntegerHash backend (seeded PCG hash, pure integer math,
+// so lattice values match the CPU exactly). Texel (i, j) holds the height at
+// nodeOrigin + (i - 1, j - 1) * spacing, so the tile has a one-texel border for the normals in
+// infinite_terrain_gpu.vert. Legacy-noise layers are filled on the CPU instead.
+out float Height;
+
+uniform vec2 nodeOrigin;
+uniform float spacing;
+uniform int noiseSeed;   // uint32 seed, bit-cast (Shader has no unsigned setter)
+
+const int OCTAVES = 6;
+const float BASE_FREQUENCY = 0.005;
+
+// PCG output permutation (NoiseFbm.h IntegerHash::Pcg)
+uint pcg(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+uint integerRow(int iz, int octave) {
+    return pcg(uint(iz) + pcg(uint(noiseSeed) + uint(octave) * 0x9E3779B9u));
+}
+
+float integerValue(int ix, uint row) {
+    return float(pcg(uint(ix) + row) >> 8u) * (2.0 / 16777216.0) - 1.0;
+}
+
+// 2D value noise
+float valueNoise(vec2 p, int octave) {
+    vec2 cell = floor(p);
+    ivec2 i = ivec2(cell);
+    vec2 f = p - cell;
+    uint row0 = integerRow(i.y, octave);
+    uint row1 = integerRow(i.y + 1, octave);
+    float v00 = integerValue(i.x, row0);
+    float v10 = integerValue(i.x + 1, row0);
+    float v01 = integerValue(i.x, row1);
+    float v11 = integerValue(i.x + 1, row1);
+    vec2 u = f * f * (3.0 - 2.0 * f);
+    float a = mix(v00, v10, u.x);
+    float b = mix(v01, v11, u.x);
+    return mix(a, b, u.y);
+}
+
+float fbm(vec2 p) {
+    float amplitude = 1.0;
+    float frequency = BASE_FREQUENCY;
+    float maxAmp = 0.0;
+    float sum = 0.0;
+    for (int i = 0; i < OCTAVES; ++i) {
+        sum += valueNoise(p * frequency, i) * amplitude;
+        maxAmp += amplitude;
+        amplitude *= 0.5;
+        frequency *= 2.0;
+    }
+    return sum / maxAmp * 100.0 - 10.0;
+}
+
+void main() {
+    vec2 texel = floor(gl_FragCoord.xy);
+    Height = fbm(nodeOrigin + (texel - 1.0) * spacing);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Instruction sets usable at runtime on this machine (CPUID + OS support checks).
+// SIMD kernels are compiled for their target ISA individually and picked with this.
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx2 = false;
+
+    static const CpuFeatures& Get();
+};
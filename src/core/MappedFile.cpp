@@ -0,0 +1,113 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path, size_t size) {
+    Close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "[MappedFile] Failed to open " << path << " (error " << GetLastError() << ")" << std::endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    fileSize.QuadPart = (LONGLONG)size;
+    if (!SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+        std::cerr << "[MappedFile] Failed to resize " << path << " to " << size << " bytes" << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32),
+                                        (DWORD)(size & 0xFFFFFFFFu), nullptr);
+    void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : nullptr;
+    if (!data) {
+        std::cerr << "[MappedFile] Failed to map " << path << " (error " << GetLastError() << ")" << std::endl;
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_File = file;
+    m_Mapping = mapping;
+    m_Data = (uint8_t*)data;
+    m_Size = size;
+    return true;
+}
+
+void MappedFile::Flush() {
+    if (!m_Data) return;
+    FlushViewOfFile(m_Data, m_Size);
+}
+
+void MappedFile::Close() {
+    if (m_Data) {
+        FlushViewOfFile(m_Data, m_Size);
+        UnmapViewOfFile(m_Data);
+    }
+    if (m_Mapping) CloseHandle((HANDLE)m_Mapping);
+    if (m_File) CloseHandle((HANDLE)m_File);
+    m_File = nullptr;
+    m_Mapping = nullptr;
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path, size_t size) {
+    Close();
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "[MappedFile] Failed to open " << path << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        std::cerr << "[MappedFile] Failed to resize " << path << " to " << size << " bytes" << std::endl;
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        std::cerr << "[MappedFile] Failed to map " << path << std::endl;
+        close(fd);
+        return false;
+    }
+    m_Fd = fd;
+    m_Data = (uint8_t*)data;
+    m_Size = size;
+    return true;
+}
+
+void MappedFile::Flush() {
+    if (!m_Data) return;
+    msync(m_Data, m_Size, MS_ASYNC);
+}
+
+void MappedFile::Close() {
+    if (m_Data) {
+        msync(m_Data, m_Size, MS_SYNC);
+        munmap(m_Data, m_Size);
+    }
+    if (m_Fd >= 0) close(m_Fd);
+    m_Fd = -1;
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+#endif
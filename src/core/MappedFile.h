@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read/write memory mapping of a whole file (Win32 file mapping or POSIX mmap).
+// Writes through GetData() reach the file when the OS pages them out, on Flush() or on Close().
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Opens (creating if needed) the file, resizes it to size bytes and maps it.
+    // Existing contents up to size are kept; new bytes read as zero.
+    bool Open(const std::string& path, size_t size);
+    void Close();
+    void Flush();
+
+    bool IsOpen() const { return m_Data != nullptr; }
+    uint8_t* GetData() const { return m_Data; }
+    size_t GetSize() const { return m_Size; }
+
+private:
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#else
+    int m_Fd = -1;
+#endif
+    uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+};
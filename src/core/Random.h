@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+// Small, fast PCG32 generator (O'Neill, "PCG: A Family of Simple Fast Space-Efficient
+// Statistically Good Algorithms for Random Number Generation"). One instance per owner;
+// not thread-safe.
+class Pcg32 {
+public:
+    explicit Pcg32(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+        m_Increment = (stream << 1u) | 1u;
+        m_State = 0;
+        NextU32();
+        m_State += seed;
+        NextU32();
+    }
+
+    uint32_t NextU32() {
+        uint64_t old = m_State;
+        m_State = old * 6364136223846793005ULL + m_Increment;
+        uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = (uint32_t)(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+    }
+
+    // [0, 1) from the top 24 bits, exactly representable
+    float NextFloat01() { return (float)(NextU32() >> 8) * (1.0f / 16777216.0f); }
+    // [-1, 1)
+    float NextFloat11() { return NextFloat01() * 2.0f - 1.0f; }
+
+private:
+    uint64_t m_State;
+    uint64_t m_Increment;
+};
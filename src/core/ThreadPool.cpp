@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+// Shared by the jobs of one ParallelFor. Jobs that start after every range was claimed return
+// without touching the body, so only this batch has to outlive them.
+struct ParallelBatch {
+    std::atomic<int> nextRange{0};
+    std::atomic<int> rangesDone{0};
+    int rangeCount = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        unsigned int hw = std::thread::hardware_concurrency();
+        threadCount = hw > 1 ? hw - 1 : 1;
+    }
+    m_Threads.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_Threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+    std::cout << "[ThreadPool] Started " << threadCount << " worker thread(s)" << std::endl;
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+        // Jobs that have not started yet are dropped; their owners are going away too
+        m_Jobs.clear();
+    }
+    m_Condition.notify_all();
+    for (auto& thread : m_Threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Jobs.push_back(std::move(job));
+    }
+    m_Condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(int rangeCount, const std::function<void(int)>& body) {
+    if (rangeCount <= 0) return;
+    if (rangeCount == 1) {
+        body(0);
+        return;
+    }
+    auto batch = std::make_shared<ParallelBatch>();
+    batch->rangeCount = rangeCount;
+    const std::function<void(int)>* bodyPtr = &body;
+    auto runRanges = [batch, bodyPtr]() {
+        for (;;) {
+            int range = batch->nextRange.fetch_add(1);
+            if (range >= batch->rangeCount) return;
+            (*bodyPtr)(range);
+            if (batch->rangesDone.fetch_add(1) + 1 == batch->rangeCount) {
+                std::lock_guard<std::mutex> lock(batch->mutex);
+                batch->finished.notify_one();
+            }
+        }
+    };
+    int helpers = std::min((int)m_Threads.size(), rangeCount - 1);
+    for (int i = 0; i < helpers; ++i) {
+        Submit(runRanges);
+    }
+    runRanges();
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&batch] { return batch->rangesDone.load() == batch->rangeCount; });
+}
+
+size_t ThreadPool::GetQueuedJobCount() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Jobs.size();
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Condition.wait(lock, [this] { return m_Stopping || !m_Jobs.empty(); });
+            if (m_Stopping) return;
+            job = std::move(m_Jobs.front());
+            m_Jobs.pop_front();
+        }
+        job();
+    }
+}
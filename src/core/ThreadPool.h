@@ -0,0 +1,37 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size worker pool for CPU-side work (terrain chunk meshing, etc.).
+// Jobs must not touch OpenGL: there is only one context and it lives on the main thread.
+class ThreadPool {
+public:
+    // threadCount == 0 picks hardware_concurrency() - 1 (at least 1), leaving a core for rendering
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> job);
+    // Runs body(0) .. body(rangeCount - 1) and returns when all have finished. Ranges are claimed
+    // from a shared counter by the workers and by the calling thread, so this never waits for a
+    // worker that is still busy with other jobs (terrain meshing).
+    void ParallelFor(int rangeCount, const std::function<void(int)>& body);
+
+    unsigned int GetThreadCount() const { return (unsigned int)m_Threads.size(); }
+    size_t GetQueuedJobCount() const;
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_Threads;
+    std::deque<std::function<void()>> m_Jobs;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Stopping = false;
+};
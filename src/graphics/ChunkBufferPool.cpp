@@ -0,0 +1,55 @@
+#include "ChunkBufferPool.h"
+#include <glad/glad.h>
+#include <iostream>
+
+ChunkBufferPool::ChunkBufferPool(size_t slotBytes, int slotCount)
+    : m_SlotBytes(slotBytes) {
+    m_Stats.capacity = slotCount;
+    glGenBuffers(1, &m_Buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(slotBytes * slotCount), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Hand out low slots first
+    m_FreeSlots.reserve(slotCount);
+    for (int i = slotCount - 1; i >= 0; --i) {
+        m_FreeSlots.push_back(i);
+    }
+    std::cout << "[ChunkBufferPool] " << slotCount << " slots x " << slotBytes << " bytes ("
+              << (slotBytes * slotCount) / 1024 << " KB)" << std::endl;
+}
+
+ChunkBufferPool::~ChunkBufferPool() {
+    glDeleteBuffers(1, &m_Buffer);
+}
+
+int ChunkBufferPool::Acquire() {
+    if (m_FreeSlots.empty()) {
+        m_Stats.failedAcquires++;
+        return -1;
+    }
+    int slot = m_FreeSlots.back();
+    m_FreeSlots.pop_back();
+    m_Stats.used++;
+    if (m_Stats.used > m_Stats.highWaterMark) {
+        m_Stats.highWaterMark = m_Stats.used;
+    }
+    return slot;
+}
+
+void ChunkBufferPool::Release(int slot) {
+    if (slot < 0 || slot >= m_Stats.capacity) return;
+    m_FreeSlots.push_back(slot);
+    m_Stats.used--;
+}
+
+void ChunkBufferPool::Upload(int slot, const void* data, size_t bytes) {
+    if (slot < 0 || slot >= m_Stats.capacity || bytes > m_SlotBytes) {
+        std::cerr << "[ChunkBufferPool] Invalid upload: slot " << slot << ", " << bytes << " bytes" << std::endl;
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)GetSlotOffset(slot), (GLsizeiptr)bytes, data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_Stats.bytesUploaded += bytes;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Fixed-size vertex slots carved out of one large GL_ARRAY_BUFFER.
+// The buffer is allocated once up front; chunks borrow a slot, fill it with glBufferSubData
+// and give it back when evicted, so streaming never creates or deletes GL objects.
+// Since every slot lives in the same buffer, one VAO covers all of them and a slot is
+// selected at draw time through basevertex = slot * verticesPerSlot.
+class ChunkBufferPool {
+public:
+    struct Stats {
+        int capacity = 0;
+        int used = 0;
+        int highWaterMark = 0;
+        int failedAcquires = 0;     // Acquire() calls that found the pool full
+        size_t bytesUploaded = 0;   // since construction
+    };
+
+    ChunkBufferPool(size_t slotBytes, int slotCount);
+    ~ChunkBufferPool();
+
+    ChunkBufferPool(const ChunkBufferPool&) = delete;
+    ChunkBufferPool& operator=(const ChunkBufferPool&) = delete;
+
+    // Returns a free slot index, or -1 when every slot is in use
+    int Acquire();
+    void Release(int slot);
+    // Writes bytes (<= slot size) at the start of the slot
+    void Upload(int slot, const void* data, size_t bytes);
+
+    unsigned int GetBuffer() const { return m_Buffer; }
+    size_t GetSlotBytes() const { return m_SlotBytes; }
+    size_t GetSlotOffset(int slot) const { return (size_t)slot * m_SlotBytes; }
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    unsigned int m_Buffer = 0;
+    size_t m_SlotBytes;
+    std::vector<int> m_FreeSlots;
+    Stats m_Stats;
+};
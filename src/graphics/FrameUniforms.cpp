@@ -0,0 +1,22 @@
+#include "FrameUniforms.h"
+#include "Shader.h"
+
+FrameUniforms::FrameUniforms() {
+    glGenBuffers(1, &m_Buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    // Binding points are context state, so this holds for every program linked before or after
+    glBindBufferBase(GL_UNIFORM_BUFFER, Shader::FrameDataBinding, m_Buffer);
+}
+
+FrameUniforms::~FrameUniforms() {
+    glDeleteBuffers(1, &m_Buffer);
+}
+
+void FrameUniforms::Upload(const FrameData& data) {
+    m_Data = data;
+    glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &m_Data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
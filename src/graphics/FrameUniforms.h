@@ -0,0 +1,39 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Per-frame camera and lighting values, laid out as the std140 FrameData block in
+// assets/shaders/frame_data.glsl; keep the two in sync. vec3s are stored in vec4s (w unused).
+struct FrameData {
+    glm::mat4 projection;
+    glm::mat4 cameraView;          // the fly camera: terrain, stars
+    glm::mat4 followView;          // the chase camera behind the plane: plane, particles, contrails
+    glm::vec4 cameraPos;
+    glm::vec4 followCameraPos;
+    glm::vec4 lightPos;
+    glm::vec4 lightColor;
+    float time = 0.0f;             // seconds since start
+    float pointScale = 1.0f;       // particle point size scale for the current render target
+    float padding[2] = { 0.0f, 0.0f };
+};
+static_assert(sizeof(FrameData) == 3 * 64 + 4 * 16 + 16, "FrameData must match the std140 block");
+
+// Owns the uniform buffer behind FrameData, bound to Shader::FrameDataBinding, so every program
+// that includes frame_data.glsl sees the same values after one upload per frame.
+class FrameUniforms {
+public:
+    FrameUniforms();
+    ~FrameUniforms();
+
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    // Replaces the whole block; call once per frame before drawing
+    void Upload(const FrameData& data);
+
+    const FrameData& GetData() const { return m_Data; }
+
+private:
+    unsigned int m_Buffer = 0;
+    FrameData m_Data;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// View frustum as six inward-facing planes (ax + by + cz + d >= 0 is inside),
+// extracted from a view-projection matrix (Gribb & Hartmann).
+class Frustum {
+public:
+    explicit Frustum(const glm::mat4& viewProjection) {
+        // glm is column-major: row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+        glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+        glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+        glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+        glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+        m_Planes[0] = row3 + row0; // left
+        m_Planes[1] = row3 - row0; // right
+        m_Planes[2] = row3 + row1; // bottom
+        m_Planes[3] = row3 - row1; // top
+        m_Planes[4] = row3 + row2; // near
+        m_Planes[5] = row3 - row2; // far
+    }
+
+    // False only when the box is completely outside one of the planes
+    bool IntersectsAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+        for (const glm::vec4& plane : m_Planes) {
+            // Corner of the box furthest along the plane normal
+            glm::vec3 p(plane.x >= 0.0f ? boxMax.x : boxMin.x,
+                        plane.y >= 0.0f ? boxMax.y : boxMin.y,
+                        plane.z >= 0.0f ? boxMax.z : boxMin.z);
+            if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    glm::vec4 m_Planes[6];
+};
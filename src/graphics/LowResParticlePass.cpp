@@ -0,0 +1,139 @@
+#include "LowResParticlePass.h"
+#include "SceneDepthCopy.h"
+#include "Shader.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+unsigned int CreateTarget(GLenum internalFormat, GLenum format, GLenum type, int width, int height, GLint filter) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+}
+
+LowResParticlePass::LowResParticlePass(int divisor)
+    : m_Divisor(std::max(1, divisor)) {
+    glGenFramebuffers(1, &m_Framebuffer);
+    glGenVertexArrays(1, &m_EmptyVAO);
+    m_DownsampleShader = std::make_unique<Shader>("assets/shaders/fullscreen.vert", "assets/shaders/particle_depth_downsample.frag");
+    m_CompositeShader = std::make_unique<Shader>("assets/shaders/fullscreen.vert", "assets/shaders/particle_composite.frag");
+    // Everything but the depth range is fixed for the pass's lifetime; set once each program has
+    // finished building (first Begin)
+    m_DownsampleShader->OnFinish([this] {
+        m_DownsampleShader->setInt("sceneDepth", 0);
+        m_DownsampleShader->setInt("divisor", m_Divisor);
+    });
+    m_CompositeShader->OnFinish([this] {
+        m_CompositeShader->setInt("particleColor", 0);
+        m_CompositeShader->setInt("particleDepth", 1);
+        m_CompositeShader->setInt("sceneDepth", 2);
+        m_CompositeShader->setFloat("edgeThreshold", 0.1f);
+        m_NearPlaneLocation = m_CompositeShader->GetUniform("nearPlane");
+        m_FarPlaneLocation = m_CompositeShader->GetUniform("farPlane");
+    });
+}
+
+LowResParticlePass::~LowResParticlePass() {
+    DeleteTargets();
+    glDeleteFramebuffers(1, &m_Framebuffer);
+    glDeleteVertexArrays(1, &m_EmptyVAO);
+}
+
+void LowResParticlePass::DeleteTargets() {
+    unsigned int textures[2] = { m_LowColor, m_LowDepth };
+    glDeleteTextures(2, textures);
+    m_LowColor = m_LowDepth = 0;
+}
+
+void LowResParticlePass::EnsureTargets(int width, int height) {
+    if (width == m_Width && height == m_Height && m_LowColor) return;
+    DeleteTargets();
+    m_Width = width;
+    m_Height = height;
+    m_LowWidth = std::max(1, (width + m_Divisor - 1) / m_Divisor);
+    m_LowHeight = std::max(1, (height + m_Divisor - 1) / m_Divisor);
+
+    m_LowDepth = CreateTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, m_LowWidth, m_LowHeight, GL_NEAREST);
+    // Bilinear for the composite's smooth regions
+    m_LowColor = CreateTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, m_LowWidth, m_LowHeight, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_LowColor, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_LowDepth, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[LowResParticlePass] Framebuffer incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, m_PreviousFramebuffer);
+    std::cout << "[LowResParticlePass] " << m_LowWidth << "x" << m_LowHeight << " particle target for "
+              << width << "x" << height << std::endl;
+}
+
+void LowResParticlePass::Begin(const SceneDepthCopy& sceneDepth) {
+    m_SceneDepth = &sceneDepth;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_PreviousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, m_PreviousViewport);
+    EnsureTargets(sceneDepth.GetWidth(), sceneDepth.GetHeight());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+    glViewport(0, 0, m_LowWidth, m_LowHeight);
+
+    // Depth reduction: every texel is written, so no depth clear is needed
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthFunc(GL_ALWAYS);
+    glDepthMask(GL_TRUE);
+    m_DownsampleShader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth.GetTexture());
+    glBindVertexArray(m_EmptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glDepthFunc(GL_LESS);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void LowResParticlePass::End() {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_PreviousFramebuffer);
+    glViewport(m_PreviousViewport[0], m_PreviousViewport[1], m_PreviousViewport[2], m_PreviousViewport[3]);
+
+    GLboolean depthEnabled = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_CompositeShader->use();
+    m_CompositeShader->setFloat(m_NearPlaneLocation, m_SceneDepth->GetNearPlane());
+    m_CompositeShader->setFloat(m_FarPlaneLocation, m_SceneDepth->GetFarPlane());
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_LowColor);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_LowDepth);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_SceneDepth->GetTexture());
+    glBindVertexArray(m_EmptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    if (depthEnabled) glEnable(GL_DEPTH_TEST);
+    m_SceneDepth = nullptr;
+}
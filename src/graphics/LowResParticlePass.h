@@ -0,0 +1,51 @@
+#pragma once
+#include <glad/glad.h>
+#include <memory>
+
+class Shader;
+class SceneDepthCopy;
+
+// Renders alpha-blended particles into a 1/divisor resolution target and composites them back,
+// cutting their fill cost by divisor^2. Begin takes the scene depth, reduces it to the target's
+// resolution (nearest depth per block) so particles are still occluded by the scene, and binds
+// the target; End restores the previous framebuffer and upsamples the particles over it, picking
+// the nearest-depth low-resolution texel across depth edges.
+// Particles drawn in between must blend alpha as coverage (glBlendFuncSeparate with GL_ONE,
+// GL_ONE_MINUS_SRC_ALPHA for alpha) so the target holds premultiplied colour, and should scale
+// their point sizes by GetPointScale().
+class LowResParticlePass {
+public:
+    // divisor: 2 for half, 4 for quarter resolution
+    LowResParticlePass(int divisor = 2);
+    ~LowResParticlePass();
+
+    LowResParticlePass(const LowResParticlePass&) = delete;
+    LowResParticlePass& operator=(const LowResParticlePass&) = delete;
+
+    // sceneDepth: captured from the framebuffer bound now, after the opaque scene; its size and
+    // clip planes are used for the target and the depth linearisation
+    void Begin(const SceneDepthCopy& sceneDepth);
+    void End();
+
+    int GetDivisor() const { return m_Divisor; }
+    float GetPointScale() const { return 1.0f / (float)m_Divisor; }
+
+private:
+    void EnsureTargets(int width, int height);
+    void DeleteTargets();
+
+    int m_Divisor;
+    const SceneDepthCopy* m_SceneDepth = nullptr;   // between Begin and End
+    int m_Width = 0, m_Height = 0;             // full resolution
+    int m_LowWidth = 0, m_LowHeight = 0;
+    GLint m_PreviousFramebuffer = 0;
+    GLint m_PreviousViewport[4] = { 0, 0, 0, 0 };
+
+    unsigned int m_LowColor = 0;
+    unsigned int m_LowDepth = 0;
+    unsigned int m_Framebuffer = 0;
+    unsigned int m_EmptyVAO = 0;
+    std::unique_ptr<Shader> m_DownsampleShader;
+    std::unique_ptr<Shader> m_CompositeShader;
+    GLint m_NearPlaneLocation = -1, m_FarPlaneLocation = -1;
+};
@@ -0,0 +1,28 @@
+#include "SceneDepthCopy.h"
+
+SceneDepthCopy::~SceneDepthCopy() {
+    glDeleteTextures(1, &m_Texture);
+}
+
+void SceneDepthCopy::Capture(const glm::mat4& viewProjection, float nearPlane, float farPlane) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (!m_Texture || viewport[2] != m_Width || viewport[3] != m_Height) {
+        glDeleteTextures(1, &m_Texture);
+        m_Width = viewport[2];
+        m_Height = viewport[3];
+        glGenTextures(1, &m_Texture);
+        glBindTexture(GL_TEXTURE_2D, m_Texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, m_Width, m_Height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, m_Texture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], m_Width, m_Height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_ViewProjection = viewProjection;
+    m_Near = nearPlane;
+    m_Far = farPlane;
+}
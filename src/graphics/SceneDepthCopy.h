@@ -0,0 +1,32 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// The scene's depth buffer copied into a texture, for passes that read depth while drawing into
+// the same framebuffer (LowResParticlePass) or one frame later (GPU particle collision).
+class SceneDepthCopy {
+public:
+    SceneDepthCopy() = default;
+    ~SceneDepthCopy();
+
+    SceneDepthCopy(const SceneDepthCopy&) = delete;
+    SceneDepthCopy& operator=(const SceneDepthCopy&) = delete;
+
+    // Copies the read framebuffer's depth over the current viewport. viewProjection and the clip
+    // planes are those the scene was drawn with, so readers can project into the copy.
+    void Capture(const glm::mat4& viewProjection, float nearPlane, float farPlane);
+
+    bool IsValid() const { return m_Texture != 0; }
+    unsigned int GetTexture() const { return m_Texture; }
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+    const glm::mat4& GetViewProjection() const { return m_ViewProjection; }
+    float GetNearPlane() const { return m_Near; }
+    float GetFarPlane() const { return m_Far; }
+
+private:
+    unsigned int m_Texture = 0;
+    int m_Width = 0, m_Height = 0;
+    glm::mat4 m_ViewProjection = glm::mat4(1.0f);
+    float m_Near = 1.0f, m_Far = 10000.0f;
+};
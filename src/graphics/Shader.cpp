@@ -1,86 +1,271 @@
 #include "Shader.h"
+#include "ShaderProgramCache.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    
+// GL_KHR_parallel_shader_compile (same value as the ARB extension); glad was generated without it
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream file;
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     try {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        
-        vShaderFile.close();
-        fShaderFile.close();
-        
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        file.open(path);
+        std::stringstream stream;
+        stream << file.rdbuf();
+        return stream.str();
     }
     catch (std::ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << " " << e.what() << std::endl;
     }
+    return std::string();
+}
+
+// The file with each #include "name" line replaced by that file (from the same directory),
+// followed by a #line so compile errors still report the including file's line numbers
+std::string LoadSource(const std::string& path, int depth = 0) {
+    std::string source = ReadFile(path);
+    if (depth > 8 || source.find("#include") == std::string::npos) return source;
+
+    size_t slash = path.find_last_of("/\\");
+    std::string directory = (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+    std::stringstream in(source);
+    std::string out, line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        size_t directive = line.find("#include");
+        size_t open = line.find('"', directive);
+        size_t close = (open == std::string::npos) ? open : line.find('"', open + 1);
+        if (directive == std::string::npos || close == std::string::npos) {
+            out += line + "\n";
+            continue;
+        }
+        out += LoadSource(directory + line.substr(open + 1, close - open - 1), depth + 1);
+        out += "\n#line " + std::to_string(lineNumber + 1) + "\n";
+    }
+    return out;
+}
+
+}
+
+ShaderProgramCache* Shader::s_ProgramCache = nullptr;
+
+void Shader::SetProgramCache(ShaderProgramCache* cache) {
+    s_ProgramCache = cache;
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+    // 1. retrieve the vertex/fragment source code from filePath
+    std::string vertexCode = LoadSource(vertexPath);
+    std::string fragmentCode = LoadSource(fragmentPath);
     
-    const char* vShaderCode = vertexCode.c_str();
-    const char * fShaderCode = fragmentCode.c_str();
+    // 2. use the stored binary if this exact program was built before
+    ID = glCreateProgram();
+    if (s_ProgramCache && s_ProgramCache->IsEnabled()) {
+        m_CacheKey = s_ProgramCache->MakeKey({ vertexCode, fragmentCode });
+        if (loadCachedProgram()) return;
+    }
     
-    // 2. compile shaders
-    unsigned int vertex, fragment;
+    // 3. compile shaders; errors are checked in Finish
+    m_Vertex = compileStage(GL_VERTEX_SHADER, vertexCode);
+    m_Fragment = compileStage(GL_FRAGMENT_SHADER, fragmentCode);
     
-    // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    // shader Program
+    glAttachShader(ID, m_Vertex);
+    glAttachShader(ID, m_Fragment);
+    linkProgram();
+}
+
+Shader::Shader(const char* vertexPath, const std::vector<const char*>& feedbackVaryings) {
+    std::string vertexCode = LoadSource(vertexPath);
     
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+    ID = glCreateProgram();
+    if (s_ProgramCache && s_ProgramCache->IsEnabled()) {
+        std::vector<std::string> keySources = { vertexCode };
+        keySources.insert(keySources.end(), feedbackVaryings.begin(), feedbackVaryings.end());
+        m_CacheKey = s_ProgramCache->MakeKey(keySources);
+        if (loadCachedProgram()) return;
+    }
     
-    // shader Program
+    m_Vertex = compileStage(GL_VERTEX_SHADER, vertexCode);
+    glAttachShader(ID, m_Vertex);
+    // Varyings must be declared before linking
+    glTransformFeedbackVaryings(ID, (GLsizei)feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+    linkProgram();
+}
+
+Shader::~Shader() {
+    if (m_Vertex) glDeleteShader(m_Vertex);
+    if (m_Fragment) glDeleteShader(m_Fragment);
+    glDeleteProgram(ID);
+}
+
+unsigned int Shader::compileStage(GLenum stage, const std::string& source) {
+    const char* code = source.c_str();
+    unsigned int shader = glCreateShader(stage);
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+bool Shader::loadCachedProgram() {
+    if (s_ProgramCache->Load(m_CacheKey, ID)) {
+        reflectProgram();
+        return true;
+    }
+    // A refused binary can leave the program in an unusable state
+    glDeleteProgram(ID);
     ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
+    return false;
+}
+
+void Shader::linkProgram() {
+    if (s_ProgramCache) {
+        s_ProgramCache->PrepareProgram(ID);
+        s_ProgramCache->CountCompiled();
+    }
     glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    m_Pending = true;
+}
+
+bool Shader::IsReady() const {
+    if (!m_Pending) return true;
+    if (!s_ProgramCache || !s_ProgramCache->HasParallelCompile()) return true;
+    GLint complete = GL_FALSE;
+    glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+void Shader::Finish() const {
+    if (!m_Pending) return;
+    m_Pending = false;
+    checkCompileErrors(m_Vertex, "VERTEX");
+    if (m_Fragment) checkCompileErrors(m_Fragment, "FRAGMENT");
+    bool linked = checkCompileErrors(ID, "PROGRAM");
     
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    glDetachShader(ID, m_Vertex);
+    glDeleteShader(m_Vertex);
+    if (m_Fragment) {
+        glDetachShader(ID, m_Fragment);
+        glDeleteShader(m_Fragment);
+    }
+    m_Vertex = m_Fragment = 0;
+    
+    reflectProgram();
+    if (linked && s_ProgramCache) s_ProgramCache->Store(m_CacheKey, ID);
+    runFinishSetup();
+}
+
+void Shader::OnFinish(std::function<void()> setup) {
+    m_FinishSetup = std::move(setup);
+    if (!m_Pending) runFinishSetup();
+}
+
+void Shader::runFinishSetup() const {
+    if (!m_FinishSetup) return;
+    // Cleared first: the setup's own GetUniform/use calls come back through Finish
+    std::function<void()> setup = std::move(m_FinishSetup);
+    m_FinishSetup = nullptr;
+    GLint previous = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+    glUseProgram(ID);
+    setup();
+    glUseProgram((GLuint)previous);
 }
 
 void Shader::use() { 
+    Finish();
     glUseProgram(ID); 
 }
 
+GLint Shader::GetUniform(const std::string &name) const {
+    Finish();
+    auto it = m_Uniforms.find(name);
+    return it == m_Uniforms.end() ? -1 : it->second;
+}
+
 void Shader::setBool(const std::string &name, bool value) const {         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    glUniform1i(GetUniform(name), (int)value); 
 }
 void Shader::setInt(const std::string &name, int value) const { 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1i(GetUniform(name), value); 
 }
 void Shader::setFloat(const std::string &name, float value) const { 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1f(GetUniform(name), value); 
 }
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(GetUniform(name), 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::setVec2(const std::string &name, const glm::vec2 &value) const {
+    glUniform2fv(GetUniform(name), 1, &value[0]);
 }
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(GetUniform(name), 1, &value[0]);
+}
+
+void Shader::setVec4(const std::string &name, const glm::vec4 &value) const {
+    glUniform4fv(GetUniform(name), 1, &value[0]);
+}
+
+void Shader::setInt(GLint location, int value) const {
+    glUniform1i(location, value);
+}
+void Shader::setFloat(GLint location, float value) const {
+    glUniform1f(location, value);
+}
+void Shader::setMat4(GLint location, const glm::mat4 &mat) const {
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::setVec2(GLint location, const glm::vec2 &value) const {
+    glUniform2fv(location, 1, &value[0]);
+}
+void Shader::setVec3(GLint location, const glm::vec3 &value) const {
+    glUniform3fv(location, 1, &value[0]);
+}
+void Shader::setVec4(GLint location, const glm::vec4 &value) const {
+    glUniform4fv(location, 1, &value[0]);
+}
+void Shader::setIntArray(GLint location, const int *values, int count) const {
+    glUniform1iv(location, count, values);
+}
+void Shader::setVec3Array(GLint location, const glm::vec3 *values, int count) const {
+    glUniform3fv(location, count, &values[0][0]);
+}
+
+void Shader::reflectProgram() const {
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<char> name((size_t)std::max(maxNameLength, 1));
+    for (GLint i = 0; i < uniformCount; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+        std::string uniformName(name.data(), (size_t)length);
+        GLint location = glGetUniformLocation(ID, uniformName.c_str());
+        if (location < 0) continue;   // member of a uniform block
+        // Arrays are reported as "name[0]"
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+            uniformName.resize(uniformName.size() - 3);
+        }
+        m_Uniforms[uniformName] = location;
+    }
+
+    GLuint frameBlock = glGetUniformBlockIndex(ID, "FrameData");
+    if (frameBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(ID, frameBlock, FrameDataBinding);
+    }
 }
 
-void Shader::checkCompileErrors(unsigned int shader, std::string type) {
+bool Shader::checkCompileErrors(unsigned int shader, std::string type) {
     int success;
     char infoLog[1024];
     if (type != "PROGRAM") {
@@ -97,4 +282,5 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type) {
             std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
+    return success != 0;
 }
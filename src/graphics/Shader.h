@@ -1,21 +1,88 @@
 #pragma once
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+// Sources may contain #include "file" lines, resolved against the including file's directory
+// (shared declarations such as frame_data.glsl). Active uniforms are reflected once at link time:
+// look a handle up with GetUniform at setup and pass it to the location setters in the render loop.
+//
+// Construction only submits the compile and link; status checks, reflection and storing the
+// binary in the program cache wait for Finish, which runs on first use. Constructing every
+// program before using any lets a parallel-compiling driver build them concurrently; owners
+// resolve their handles in an OnFinish callback so they never force the wait early.
 class Shader {
 public:
+    // Uniform binding point of the shared FrameData block (see FrameUniforms)
+    static const GLuint FrameDataBinding = 0;
+
     unsigned int ID;
     
     Shader(const char* vertexPath, const char* fragmentPath);
+    // Vertex-only program whose outputs are captured by transform feedback,
+    // interleaved into one buffer in the order given
+    Shader(const char* vertexPath, const std::vector<const char*>& feedbackVaryings);
+    // Deletes the program (and any stages still pending); needs the GL context that built it
+    ~Shader();
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
     void use();
-    
+
+    // Programs constructed afterwards are loaded from / stored into cache (nullptr: none).
+    // The cache must outlive them.
+    static void SetProgramCache(class ShaderProgramCache* cache);
+    // True once Finish would not block: always without parallel compile support
+    bool IsReady() const;
+    // Completes construction: reports compile/link errors and reflects the program. Const
+    // because every accessor calls it; it only finishes what the constructor started.
+    void Finish() const;
+    // setup runs once, at the end of Finish (right away if the program is already finished),
+    // with the program current; the previous program is restored afterwards. The place for
+    // GetUniform lookups and uniforms that stay constant
+    void OnFinish(std::function<void()> setup);
+
+    // Location reflected at link time, -1 for a uniform the program does not use (the setters
+    // ignore -1). Arrays are found by their base name.
+    GLint GetUniform(const std::string &name) const;
+
+    // By name: one table lookup per call, for setup code
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
     void setMat4(const std::string &name, const glm::mat4 &mat) const;
+    void setVec2(const std::string &name, const glm::vec2 &value) const;
     void setVec3(const std::string &name, const glm::vec3 &value) const;
+    void setVec4(const std::string &name, const glm::vec4 &value) const;
+
+    // By handle from GetUniform, for the render loop; the program must be current
+    void setInt(GLint location, int value) const;
+    void setFloat(GLint location, float value) const;
+    void setMat4(GLint location, const glm::mat4 &mat) const;
+    void setVec2(GLint location, const glm::vec2 &value) const;
+    void setVec3(GLint location, const glm::vec3 &value) const;
+    void setVec4(GLint location, const glm::vec4 &value) const;
+    void setIntArray(GLint location, const int *values, int count) const;
+    void setVec3Array(GLint location, const glm::vec3 *values, int count) const;
 
 private:
-    void checkCompileErrors(unsigned int shader, std::string type);
+    // false when shader (or the program, for type "PROGRAM") failed
+    static bool checkCompileErrors(unsigned int shader, std::string type);
+    static unsigned int compileStage(GLenum stage, const std::string& source);
+    // Links ID from the cached binary for m_CacheKey; on a miss ID is left as a fresh program
+    bool loadCachedProgram();
+    void linkProgram();
+    // Fills m_Uniforms and attaches the FrameData block, if any, to FrameDataBinding
+    void reflectProgram() const;
+    void runFinishSetup() const;
+
+    static class ShaderProgramCache* s_ProgramCache;
+    uint64_t m_CacheKey = 0;
+    mutable bool m_Pending = false;
+    mutable unsigned int m_Vertex = 0, m_Fragment = 0;
+    mutable std::unordered_map<std::string, GLint> m_Uniforms;
+    mutable std::function<void()> m_FinishSetup;
 };
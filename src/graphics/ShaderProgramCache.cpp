@@ -0,0 +1,150 @@
+#include "ShaderProgramCache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static const char ProgramMagic[8] = { 'S', 'K', 'Y', 'P', 'R', 'O', 'G', 'S' };
+static const uint32_t ProgramVersion = 1;
+
+namespace {
+
+uint64_t HashBytes(uint64_t h, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ bytes[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t HashString(uint64_t h, const char* text) {
+    if (!text) text = "";
+    // Length first, so ("ab", "c") and ("a", "bc") differ
+    uint64_t length = strlen(text);
+    h = HashBytes(h, &length, sizeof(length));
+    return HashBytes(h, text, (size_t)length);
+}
+
+bool HasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
+
+}
+
+ShaderProgramCache::ShaderProgramCache(const std::string& directory)
+    : m_Directory(directory) {
+    uint64_t h = 1469598103934665603ull;
+    h = HashString(h, (const char*)glGetString(GL_VENDOR));
+    h = HashString(h, (const char*)glGetString(GL_RENDERER));
+    h = HashString(h, (const char*)glGetString(GL_VERSION));
+    h = HashString(h, (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION));
+    m_DriverHash = h;
+
+    m_ParallelCompile = HasExtension("GL_KHR_parallel_shader_compile") || HasExtension("GL_ARB_parallel_shader_compile");
+
+    GLint formats = 0;
+    if (glGetProgramBinary && glProgramBinary && glProgramParameteri) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    std::error_code error;
+    if (formats > 0) {
+        std::filesystem::create_directories(m_Directory, error);
+        m_Enabled = !error;
+    }
+    std::string status = m_Enabled ? "Using " + m_Directory
+                       : formats <= 0 ? std::string("Program binaries unsupported (GL 4.1 entry points or formats missing), cache disabled")
+                       : "Cannot create " + m_Directory + " (" + error.message() + "), cache disabled";
+    std::cout << "[ShaderProgramCache] " << status << (m_ParallelCompile ? ", parallel compile" : "") << std::endl;
+}
+
+uint64_t ShaderProgramCache::MakeKey(const std::vector<std::string>& sources) const {
+    uint64_t h = m_DriverHash;
+    for (const std::string& source : sources) {
+        h = HashString(h, source.c_str());
+    }
+    return h;
+}
+
+std::string ShaderProgramCache::PathFor(uint64_t key) const {
+    std::ostringstream path;
+    path << m_Directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return path.str();
+}
+
+bool ShaderProgramCache::Load(uint64_t key, unsigned int program) {
+    if (!m_Enabled) return false;
+    std::ifstream file(PathFor(key), std::ios::binary);
+    if (!file) return false;
+
+    Header header;
+    if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, ProgramMagic, sizeof(ProgramMagic)) != 0 ||
+        header.version != ProgramVersion || header.key != key || header.length == 0 || header.length > (1u << 30)) {
+        m_Stats.rejected++;
+        return false;
+    }
+    std::vector<char> binary((size_t)header.length);
+    if (!file.read(binary.data(), (std::streamsize)binary.size())) {
+        m_Stats.rejected++;
+        return false;
+    }
+
+    glProgramBinary(program, (GLenum)header.binaryFormat, binary.data(), (GLsizei)binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        m_Stats.rejected++;
+        return false;
+    }
+    m_Stats.loaded++;
+    return true;
+}
+
+void ShaderProgramCache::Store(uint64_t key, unsigned int program) {
+    if (!m_Enabled) return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> binary((size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) return;
+
+    Header header;
+    memcpy(header.magic, ProgramMagic, sizeof(ProgramMagic));
+    header.version = ProgramVersion;
+    header.binaryFormat = (uint32_t)format;
+    header.key = key;
+    header.length = (uint64_t)written;
+    // Written under a temporary name and renamed, so an interrupted run never leaves a torn file
+    std::string path = PathFor(key);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), written);
+        if (!file) {
+            std::cerr << "[ShaderProgramCache] Failed to write " << temporary << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::cerr << "[ShaderProgramCache] Failed to store " << path << ": " << error.message() << std::endl;
+        return;
+    }
+    m_Stats.stored++;
+}
+
+void ShaderProgramCache::PrepareProgram(unsigned int program) const {
+    if (m_Enabled) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Linked program binaries on disk, one file per program, so later runs skip compiling and
+// linking. A program's key hashes its preprocessed sources, its transform feedback varyings
+// and the driver's vendor/renderer/version strings: editing a shader or updating the driver
+// gives a new key, and a binary the driver still rejects is recompiled and overwritten.
+//
+// File layout: Header, then header.length bytes from glGetProgramBinary.
+//
+// Needs glGetProgramBinary/glProgramBinary, which glad loads for GL 4.1+ contexts; elsewhere the
+// cache is disabled and every program compiles from source. Also reports whether the driver
+// compiles in the background (KHR/ARB_parallel_shader_compile), which Shader uses to defer
+// status checks. Create it once the context is current and install it with Shader::SetProgramCache.
+class ShaderProgramCache {
+public:
+    struct Stats {
+        int loaded = 0;      // programs linked from a stored binary
+        int compiled = 0;    // programs built from source (no binary, or rejected)
+        int rejected = 0;    // stored binaries the driver refused
+        int stored = 0;      // binaries written
+    };
+
+    explicit ShaderProgramCache(const std::string& directory);
+
+    ShaderProgramCache(const ShaderProgramCache&) = delete;
+    ShaderProgramCache& operator=(const ShaderProgramCache&) = delete;
+
+    bool IsEnabled() const { return m_Enabled; }
+    bool HasParallelCompile() const { return m_ParallelCompile; }
+
+    // sources: the preprocessed stage sources followed by any feedback varyings
+    uint64_t MakeKey(const std::vector<std::string>& sources) const;
+    // Links program from the binary stored under key; false when there is none or the driver
+    // refuses it, in which case program must be recreated before compiling
+    bool Load(uint64_t key, unsigned int program);
+    // program must be linked and have been created with the retrievable hint (PrepareProgram)
+    void Store(uint64_t key, unsigned int program);
+    // Call before linking a program from source so its binary can be retrieved
+    void PrepareProgram(unsigned int program) const;
+    void CountCompiled() { m_Stats.compiled++; }
+
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t binaryFormat;
+        uint64_t key;
+        uint64_t length;
+    };
+
+    std::string PathFor(uint64_t key) const;
+
+    std::string m_Directory;
+    bool m_Enabled = false;
+    bool m_ParallelCompile = false;
+    uint64_t m_DriverHash = 0;
+    Stats m_Stats;
+};
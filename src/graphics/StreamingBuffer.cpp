@@ -0,0 +1,96 @@
+#include "StreamingBuffer.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+StreamingBuffer::StreamingBuffer(size_t capacityBytes, Strategy strategy, int frameCount)
+    : m_Strategy(strategy), m_Capacity(capacityBytes),
+      m_FrameCount(strategy == Strategy::FencedRing ? (frameCount < 1 ? 1 : frameCount) : 1) {
+    m_Fences.assign(m_FrameCount, nullptr);
+    glGenBuffers(1, &m_Buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(m_Capacity * m_FrameCount), nullptr,
+                 m_Strategy == Strategy::Orphan ? GL_STREAM_DRAW : GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+StreamingBuffer::~StreamingBuffer() {
+    for (GLsync fence : m_Fences) {
+        if (fence) glDeleteSync(fence);
+    }
+    glDeleteBuffers(1, &m_Buffer);
+}
+
+void StreamingBuffer::WaitForRegion(int region) {
+    GLsync fence = m_Fences[region];
+    if (!fence) return;
+    // Usually signalled long ago; only poll then
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        auto start = std::chrono::high_resolution_clock::now();
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);   // 1 ms
+        } while (result == GL_TIMEOUT_EXPIRED);
+        auto end = std::chrono::high_resolution_clock::now();
+        m_Stats.fenceWaits++;
+        m_Stats.fenceWaitMs += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    if (result == GL_WAIT_FAILED) {
+        std::cerr << "[StreamingBuffer] glClientWaitSync failed" << std::endl;
+    }
+    glDeleteSync(fence);
+    m_Fences[region] = nullptr;
+}
+
+long long StreamingBuffer::Write(const void* data, size_t bytes, size_t alignment) {
+    if (alignment == 0) alignment = 1;
+    // Orphaned writes each get a whole fresh block
+    size_t offset = (m_Strategy == Strategy::Orphan) ? 0 : (m_Cursor + alignment - 1) / alignment * alignment;
+    if (offset + bytes > m_Capacity) {
+        m_Stats.failedWrites++;
+        return -1;
+    }
+    if (bytes == 0) return (long long)offset;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+    size_t bufferOffset;
+    if (m_Strategy == Strategy::Orphan) {
+        // A fresh block per write; earlier draws keep reading the block they were issued with
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)m_Capacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, data);
+        bufferOffset = 0;
+    } else {
+        if (!m_RegionReady) {
+            WaitForRegion(m_Region);
+            m_RegionReady = true;
+        }
+        bufferOffset = (size_t)m_Region * m_Capacity + offset;
+        void* dst = glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)bufferOffset, (GLsizeiptr)bytes,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (!dst) {
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            std::cerr << "[StreamingBuffer] glMapBufferRange failed" << std::endl;
+            m_Stats.failedWrites++;
+            return -1;
+        }
+        std::memcpy(dst, data, bytes);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (m_Strategy == Strategy::FencedRing) m_Cursor = offset + bytes;
+    m_Stats.bytesThisFrame += bytes;
+    m_Stats.bytesStreamed += bytes;
+    return (long long)bufferOffset;
+}
+
+void StreamingBuffer::EndFrame() {
+    if (m_Strategy == Strategy::FencedRing && m_RegionReady) {
+        m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_Region = (m_Region + 1) % m_FrameCount;
+    }
+    m_RegionReady = false;
+    m_Cursor = 0;
+    m_Stats.bytesLastFrame = m_Stats.bytesThisFrame;
+    m_Stats.bytesThisFrame = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// GL_ARRAY_BUFFER for data rewritten every frame (particles, trails, debug lines) that never
+// makes the driver wait for the GPU to finish reading last frame's contents.
+//   Orphan: every Write re-specifies the storage with glBufferData(nullptr) first, so the
+//     driver hands out fresh memory while the GPU keeps the old block until it is done.
+//   FencedRing: frameCount regions of capacityBytes in one buffer; each frame writes the next
+//     region with an unsynchronized glMapBufferRange, and a fence placed by EndFrame guards the
+//     region until the GPU has drawn from it. Only a GPU more than frameCount frames behind
+//     makes Write block, and that is counted in Stats.
+class StreamingBuffer {
+public:
+    enum class Strategy { Orphan, FencedRing };
+
+    struct Stats {
+        size_t bytesThisFrame = 0;
+        size_t bytesLastFrame = 0;   // bytes streamed in the last completed frame
+        uint64_t bytesStreamed = 0;  // since construction
+        int fenceWaits = 0;          // Writes that had to wait on a fence, since construction
+        double fenceWaitMs = 0.0;    // time spent in those waits
+        int failedWrites = 0;        // Writes that did not fit in this frame's space
+    };
+
+    StreamingBuffer(size_t capacityBytes, Strategy strategy = Strategy::FencedRing, int frameCount = 3);
+    ~StreamingBuffer();
+
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+    // Copies bytes into this frame's space and returns their byte offset in GetBuffer(), a
+    // multiple of alignment (when capacityBytes is one) so it can be turned into a first vertex.
+    // FencedRing writes in one frame share capacityBytes; an Orphan write may use all of it.
+    // Returns -1 when the write does not fit.
+    long long Write(const void* data, size_t bytes, size_t alignment = 4);
+    // Call once per frame after the draws that read this frame's writes were issued
+    void EndFrame();
+
+    unsigned int GetBuffer() const { return m_Buffer; }
+    Strategy GetStrategy() const { return m_Strategy; }
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    void WaitForRegion(int region);
+
+    unsigned int m_Buffer = 0;
+    Strategy m_Strategy;
+    size_t m_Capacity;
+    int m_FrameCount;
+    int m_Region = 0;          // FencedRing: region written this frame
+    size_t m_Cursor = 0;       // bytes used in this frame's space
+    bool m_RegionReady = false;   // this frame's region has been waited for
+    std::vector<GLsync> m_Fences;
+    Stats m_Stats;
+};
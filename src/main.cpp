@@ -1,15 +1,27 @@
 #include "core/Window.h"
+#include "core/ThreadPool.h"
 #include "graphics/Shader.h"
 #include "graphics/Camera.h"
+#include "graphics/FrameUniforms.h"
+#include "graphics/LowResParticlePass.h"
+#include "graphics/SceneDepthCopy.h"
+#include "graphics/ShaderProgramCache.h"
 #include "world/InfiniteTerrain.h"
 #include "world/Skybox.h"
 #include "world/Plane.h"
 #include "world/ParticleSystem.h"
 #include "world/Stars.h"
+#include "world/WeatherVolume.h"
+#include "world/Contrails.h"
+#include "world/TerrainNoise.h"
+#include "world/NoiseBenchmark.h"
 
+#include <chrono>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <memory>
+#include <cstdlib>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -32,6 +44,12 @@ float timeSpeed = 1.0f; // 1 second = 1 minute in-game
 enum class WeatherType { None, Rain, Snow };
 WeatherType currentWeather = WeatherType::None;
 
+// Terrain generation path (G toggles CPU meshes / GPU heightmap)
+TerrainMode terrainMode = TerrainMode::CpuMesh;
+
+// P prints the streaming and particle counters once
+bool statsRequested = false;
+
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     if (firstMouse) {
         lastX = xpos;
@@ -99,13 +117,100 @@ void processInput(Window& window) {
         keyTPressed = true;
     }
     if (glfwGetKey(window.getNativeWindow(), GLFW_KEY_T) == GLFW_RELEASE) keyTPressed = false;
+    
+    // Terrain mode
+    static bool keyGPressed = false;
+    if (glfwGetKey(window.getNativeWindow(), GLFW_KEY_G) == GLFW_PRESS && !keyGPressed) {
+        terrainMode = (terrainMode == TerrainMode::CpuMesh) ? TerrainMode::GpuHeightmap : TerrainMode::CpuMesh;
+        std::cout << "Terrain: " << (terrainMode == TerrainMode::CpuMesh ? "CPU mesh" : "GPU heightmap") << std::endl;
+        keyGPressed = true;
+    }
+    if (glfwGetKey(window.getNativeWindow(), GLFW_KEY_G) == GLFW_RELEASE) keyGPressed = false;
+    
+    // Stats
+    static bool keyPPressed = false;
+    if (glfwGetKey(window.getNativeWindow(), GLFW_KEY_P) == GLFW_PRESS && !keyPPressed) {
+        statsRequested = true;
+        keyPPressed = true;
+    }
+    if (glfwGetKey(window.getNativeWindow(), GLFW_KEY_P) == GLFW_RELEASE) keyPPressed = false;
+}
+
+void printStats(const InfiniteTerrain& terrain, const ParticleSystem* weatherSystem) {
+    const TerrainDrawStats& draw = terrain.GetDrawStats();
+    const TerrainStreamStats& stream = terrain.GetStreamStats();
+    std::cout << "[Stats] Terrain: " << draw.chunksDrawn << " / " << draw.chunksTested << " chunks drawn ("
+              << draw.fallbackChunks << " fallbacks), " << terrain.GetHeightTileCount() << " height tiles" << std::endl;
+    std::cout << "[Stats] Streaming: " << stream.queuedChunks << " queued, " << stream.buildingChunks << " building, "
+              << stream.readyChunks << " ready, " << stream.chunksStreamed << " streamed; time to visible "
+              << stream.averageTimeToVisibleMs << " ms avg, " << stream.maxTimeToVisibleMs << " ms max" << std::endl;
+    if (!weatherSystem) return;
+    const ParticleEmitStats& emit = weatherSystem->GetEmitStats();
+    std::cout << "[Stats] Particles: ";
+    // The GPU simulation does not read its live count back
+    if (weatherSystem->GetAliveCount() >= 0) std::cout << weatherSystem->GetAliveCount() << " live; ";
+    std::cout << emit.requested << " requested, "
+              << emit.emitted << " emitted, " << emit.recycled << " recycled, " << emit.dropped << " dropped" << std::endl;
+    StreamingBuffer::Stats upload = weatherSystem->GetUploadStats();
+    std::cout << "[Stats] Particle upload: " << upload.bytesLastFrame / 1024 << " KB last frame, " << upload.fenceWaits
+              << " fence waits (" << upload.fenceWaitMs << " ms), " << upload.failedWrites << " failed writes" << std::endl;
+    ParticleDepthSort::Stats sort = weatherSystem->GetSortStats();
+    if (sort.count > 0) {
+        std::cout << "[Stats] Particle sort: " << sort.count << " particles in " << sort.milliseconds << " ms, "
+                  << (sort.incremental ? "repaired previous order" : std::to_string(sort.radixPasses) + " radix passes") << std::endl;
+    }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // Command line: --bench-noise runs the noise microbenchmark and exits,
+    // --legacy-noise keeps the original sin()-hash terrain, --seed N picks the world,
+    // --particle-weather simulates rain and snow as particles instead of the wrapping volume,
+    // with transform feedback, or on the CPU with --cpu-particles,
+    // --particle-resolution 2|4 draws particles at half or quarter resolution,
+    // --sort-particles draws CPU particles back to front
+    TerrainNoise::NoiseBackend noiseBackend = TerrainNoise::NoiseBackend::IntegerHash;
+    uint32_t worldSeed = 1337;
+    bool particleWeather = false;
+    int particleDivisor = 1;
+    bool sortParticles = false;
+    ParticleSimulation weatherSimulation = ParticleSimulation::GpuTransformFeedback;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bench-noise") {
+            RunNoiseBenchmark();
+            return 0;
+        } else if (arg == "--legacy-noise") {
+            noiseBackend = TerrainNoise::NoiseBackend::Legacy;
+        } else if (arg == "--particle-weather") {
+            particleWeather = true;
+        } else if (arg == "--particle-resolution" && i + 1 < argc) {
+            particleDivisor = std::atoi(argv[++i]);
+        } else if (arg == "--sort-particles") {
+            sortParticles = true;
+        } else if (arg == "--cpu-particles") {
+            weatherSimulation = ParticleSimulation::Cpu;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            worldSeed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+    }
+    TerrainNoise::SetBackend(noiseBackend, worldSeed);
+
     std::cout << "=== Skyscape Starting ===" << std::endl;
+    std::cout << "Terrain noise: " << TerrainNoise::GetBackendName(noiseBackend);
+    if (noiseBackend == TerrainNoise::NoiseBackend::IntegerHash) std::cout << ", seed " << worldSeed;
+    std::cout << std::endl;
+    // Each stage reports the time since the previous one finished
+    auto startupBegin = std::chrono::steady_clock::now();
+    auto stageBegin = startupBegin;
+    auto stageMs = [&stageBegin]() {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - stageBegin).count();
+        stageBegin = now;
+        return ms;
+    };
     std::cout << "[1/6] Initializing window..." << std::endl;
     Window window(1280, 720, "Skyscape - Flight Simulator");
-    std::cout << "[1/6] Window initialized" << std::endl;
+    std::cout << "[1/6] Window initialized (" << stageMs() << " ms)" << std::endl;
 
     // Callbacks
     glfwSetCursorPosCallback(window.getNativeWindow(), mouse_callback);
@@ -120,16 +225,30 @@ int main() {
 
     // Shaders
     std::cout << "[2/6] Loading shaders..." << std::endl;
+    // Linked programs persist across runs; every program below and in the stages after it
+    // is loaded from there when its sources and the driver are unchanged
+    ShaderProgramCache programCache("shader_cache");
+    Shader::SetProgramCache(&programCache);
     Shader terrainShader("assets/shaders/infinite_terrain.vert", "assets/shaders/infinite_terrain.frag");
+    Shader terrainGpuShader("assets/shaders/infinite_terrain_gpu.vert", "assets/shaders/infinite_terrain.frag");
     Shader planeShader("assets/shaders/plane.vert", "assets/shaders/plane.frag");
     Shader particleShader("assets/shaders/particle.vert", "assets/shaders/particle.frag");
     Shader starsShader("assets/shaders/stars.vert", "assets/shaders/stars.frag");
-    std::cout << "[2/6] Shaders loaded" << std::endl;
+    // Camera and lighting for every program, one upload per frame
+    FrameUniforms frameUniforms;
+    // Only submitted: their status is checked after the remaining stages, which the driver
+    // can overlap with compiling them
+    std::cout << "[2/6] Shaders submitted (" << stageMs() << " ms)" << std::endl;
+
+    // Worker threads for CPU-side generation work
+    ThreadPool workers;
 
     // Infinite Terrain (auto-generates as you fly)
+    // Chunks are meshed on the worker pool and streamed in over the first frames
     std::cout << "[3/6] Generating terrain..." << std::endl;
-    InfiniteTerrain terrain(32, 5); // chunk size 32, view distance 5 chunks (optimized for performance)
-    std::cout << "[3/6] Terrain generated" << std::endl;
+    InfiniteTerrain terrain(32, 2, 5, &workers); // chunk size 32, 2 nodes per LOD ring, 5 coarser levels (2048 unit radius)
+    terrain.EnableDiskCache("terrain_cache.bin"); // generated chunks persist across runs
+    std::cout << "[3/6] Terrain streaming started (" << stageMs() << " ms)" << std::endl;
     
     // Skybox
     std::cout << "[4/6] Loading skybox..." << std::endl;
@@ -142,24 +261,58 @@ int main() {
         "assets/textures/skybox/back.jpg"
     };
     Skybox skybox(faces);
-    std::cout << "[4/6] Skybox loaded" << std::endl;
+    std::cout << "[4/6] Skybox loaded (" << stageMs() << " ms)" << std::endl;
     
     // Stars
     std::cout << "[4.5/6] Generating stars..." << std::endl;
     Stars stars(2000);
-    std::cout << "[4.5/6] Stars generated" << std::endl;
+    std::cout << "[4.5/6] Stars generated (" << stageMs() << " ms)" << std::endl;
 
     // Plane
     std::cout << "[5/6] Loading plane model..." << std::endl;
     Plane plane;
-    std::cout << "[5/6] Plane loaded" << std::endl;
+    std::cout << "[5/6] Plane loaded (" << stageMs() << " ms)" << std::endl;
     
     // Particle Systems
     std::cout << "[6/6] Initializing particle systems..." << std::endl;
-    // ParticleSystem trailSystem(ParticleType::Trail, 2000);
-    ParticleSystem weatherSystem(ParticleType::Rain, 5000);
-    float weatherEmissionTimer = 0.0f;
-    std::cout << "[6/6] Particle systems initialized" << std::endl;
+    // Engine contrails: one ribbon per engine, 128 samples (256 vertices) and one draw call each
+    Contrails contrails(2, 128, 6.0f);
+    // Default: a fixed point set wrapped around the camera, constant CPU cost.
+    // --particle-weather, GPU: transform feedback, no per-particle CPU work.
+    // --particle-weather, CPU: updates split across the pool past 32k live particles.
+    // Particle weather splashes on the ground: CPU particles test the terrain heights, GPU ones
+    // last frame's scene depth.
+    WeatherVolume weatherVolume;
+    SceneDepthCopy sceneDepth;
+    std::unique_ptr<ParticleSystem> weatherSystem;
+    if (particleWeather) {
+        weatherSystem = std::make_unique<ParticleSystem>(ParticleType::Rain, 100000, &workers, weatherSimulation);
+        weatherSystem->SetDepthSort(sortParticles);
+        weatherSystem->SetCollision(ParticleCollision::Splash);
+        weatherSystem->SetCollisionTerrain(&terrain);
+        weatherSystem->SetCollisionDepth(&sceneDepth);
+    }
+    std::unique_ptr<LowResParticlePass> particlePass;
+    if (particleDivisor > 1) {
+        particlePass = std::make_unique<LowResParticlePass>(particleDivisor);
+    }
+    bool captureSceneDepth = particlePass || (weatherSystem && weatherSimulation == ParticleSimulation::GpuTransformFeedback);
+    std::cout << "[6/6] Particle systems initialized (" << stageMs() << " ms)" << std::endl;
+
+    // Programs still building now are what parallel compilation failed to hide
+    int programsWaitedFor = 0;
+    const Shader* startupPrograms[] = { &terrainShader, &terrainGpuShader, &planeShader, &particleShader,
+                                        &starsShader, &skybox.GetShader() };
+    for (const Shader* shader : startupPrograms) {
+        if (!shader->IsReady()) programsWaitedFor++;
+        shader->Finish();
+    }
+    planeShader.use();
+    planeShader.setVec3("planeLightColor", glm::vec3(1.0f, 0.95f, 0.9f));
+    const ShaderProgramCache::Stats& programStats = programCache.GetStats();
+    std::cout << "[Shaders] " << programStats.loaded << " programs from cache, " << programStats.compiled
+              << " compiled, " << programStats.rejected << " rejected binaries; waited for " << programsWaitedFor
+              << " (" << stageMs() << " ms)" << std::endl;
 
     // Lighting - sun position high in the sky
     glm::vec3 lightPos(500.0f, 800.0f, 300.0f);
@@ -167,9 +320,11 @@ int main() {
     // Increase camera speed for flight simulation feel
     camera.MovementSpeed = 100.0f;
 
-    std::cout << "[Initialization complete! Starting render loop]" << std::endl;
+    std::cout << "[Initialization complete in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count()
+              << " ms! Starting render loop]" << std::endl;
     std::cout << "Controls: WASD = Move, Mouse = Look, Shift = Boost, T = Speed Time" << std::endl;
-    std::cout << "Weather: 1 = Clear, 2 = Rain, 3 = Snow, ESC = Exit" << std::endl;
+    std::cout << "Weather: 1 = Clear, 2 = Rain, 3 = Snow, P = Print stats, ESC = Exit" << std::endl;
 
     // Track camera velocity for plane animation
     glm::vec3 lastCameraPos = camera.Position;
@@ -196,6 +351,10 @@ int main() {
 
         // Input
         processInput(window);
+        if (statsRequested) {
+            printStats(terrain, weatherSystem.get());
+            statsRequested = false;
+        }
         
         // Boost speed with Shift
         if (glfwGetKey(window.getNativeWindow(), GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
@@ -221,44 +380,28 @@ int main() {
         // Update plane animation with realistic turning
         plane.Update(deltaTime, cameraVelocity, camera.Front);
         
-        // Update particle systems
-        // trailSystem.Update(deltaTime);
-        
-        // Emit contrails from plane engines
-        // auto trailPositions = plane.GetTrailPositions();
-        // for (const auto& pos : trailPositions) {
-        //     trailSystem.Emit(pos, -camera.Front * 5.0f, 1);
-        // }
+        // Contrails follow the engines (positions from the plane's last Draw)
+        contrails.Update(deltaTime, plane.GetTrailPositions());
         
         // Update weather system
         if (currentWeather != WeatherType::None) {
             // Switch weather type if needed
             ParticleType newWeatherType = (currentWeather == WeatherType::Rain) ? ParticleType::Rain : ParticleType::Snow;
-            
-            weatherSystem.Update(deltaTime);
-            
-            // Emit weather particles around camera
-            weatherEmissionTimer += deltaTime;
-            if (weatherEmissionTimer > 0.016f) { // ~60 times per second
-                float emitRate = (currentWeather == WeatherType::Rain) ? 200.0f : 100.0f;
-                int particlesToEmit = static_cast<int>(emitRate * weatherEmissionTimer);
-                
-                for (int i = 0; i < particlesToEmit; i++) {
-                    // Random position in a box above and around camera
-                    float x = camera.Position.x + ((rand() % 200) - 100);
-                    float y = camera.Position.y + 50.0f + (rand() % 20);
-                    float z = camera.Position.z + ((rand() % 200) - 100);
-                    
-                    glm::vec3 emitPos(x, y, z);
-                    glm::vec3 velocity(0, -10, 0);
-                    
-                    if (currentWeather == WeatherType::Snow) {
-                        velocity.y = -2.0f;
-                    }
-                    
-                    weatherSystem.Emit(emitPos, velocity, 1);
+            if (weatherVolume.GetType() != newWeatherType) weatherVolume.SetType(newWeatherType);
+            if (weatherSystem && weatherSystem->GetType() != newWeatherType) weatherSystem->SetType(newWeatherType);
+
+            if (weatherSystem) {
+                weatherSystem->Update(deltaTime);
+
+                // Emit weather particles in a box above and around the camera
+                glm::vec3 velocity(0, -10, 0);
+                if (currentWeather == WeatherType::Snow) {
+                    velocity.y = -2.0f;
                 }
-                weatherEmissionTimer = 0.0f;
+                weatherSystem->EmitVolumeOverTime({ camera.Position + glm::vec3(0.0f, 60.0f, 0.0f), glm::vec3(100.0f, 10.0f, 100.0f) },
+                                                  velocity, deltaTime);
+            } else {
+                weatherVolume.Update(deltaTime);
             }
         }
 
@@ -305,12 +448,6 @@ int main() {
             camera.Up
         );
 
-        // 1. Draw terrain
-        terrain.Update(camera.Position);
-        terrainShader.use();
-        terrainShader.setMat4("projection", projection);
-        terrainShader.setMat4("view", view);
-        
         // Dynamic lighting based on time of day
         glm::vec3 lightColor;
         if (dayProgress > 0.0f) {
@@ -324,42 +461,49 @@ int main() {
             // Night: moonlight (blue-ish)
             lightColor = glm::vec3(0.3f, 0.3f, 0.5f);
         }
-        
-        terrainShader.setVec3("lightColor", lightColor);
-        terrainShader.setVec3("lightPos", lightPos);
-        terrainShader.setVec3("viewPos", camera.Position);
-        terrainShader.setFloat("iTime", (float)glfwGetTime());
-        terrain.Draw(terrainShader);
+
+        FrameData frame;
+        frame.projection = projection;
+        frame.cameraView = view;
+        frame.followView = thirdPersonView;
+        frame.cameraPos = glm::vec4(camera.Position, 1.0f);
+        frame.followCameraPos = glm::vec4(thirdPersonCamPos, 1.0f);
+        frame.lightPos = glm::vec4(lightPos, 1.0f);
+        frame.lightColor = glm::vec4(lightColor, 1.0f);
+        frame.time = currentFrame;
+        frame.pointScale = particlePass ? particlePass->GetPointScale() : 1.0f;
+        frameUniforms.Upload(frame);
+
+        // 1. Draw terrain
+        terrain.SetMode(terrainMode);
+        terrain.Update(camera.Position, cameraVelocity);
+        Shader& activeTerrainShader = (terrainMode == TerrainMode::GpuHeightmap) ? terrainGpuShader : terrainShader;
+        terrain.Draw(activeTerrainShader, projection * view);
 
         // 2. Draw Plane
         planeShader.use();
-        planeShader.setMat4("projection", projection);
-        planeShader.setMat4("view", thirdPersonView);
-        planeShader.setVec3("lightColor", glm::vec3(1.0f, 0.95f, 0.9f));
-        planeShader.setVec3("lightPos", lightPos);
-        planeShader.setVec3("viewPos", thirdPersonCamPos);
         plane.Draw(planeShader, planePos, camera.Front, 1.0f);
         
-        // 3. Draw Particle Systems
-        particleShader.use();
-        particleShader.setMat4("view", thirdPersonView);
-        particleShader.setMat4("projection", projection);
-        // trailSystem.Draw(particleShader.ID);
-        if (currentWeather != WeatherType::None) {
-            weatherSystem.Draw(particleShader.ID);
-        }
-        
-        // 4. Draw Stars (at night)
+        // 3. Draw Stars (at night)
         float starVisibility = glm::clamp(-dayProgress * 3.0f, 0.0f, 1.0f);
         if (starVisibility > 0.0f) {
-            starsShader.use();
-            starsShader.setMat4("view", view);
-            starsShader.setMat4("projection", projection);
             stars.Draw(starsShader.ID, starVisibility);
         }
 
-        // 5. Draw Skybox (last)
+        // 4. Draw Skybox
         skybox.Draw(view, projection);
+        if (captureSceneDepth) {
+            sceneDepth.Capture(projection * view, 1.0f, 10000.0f);   // the projection's clip planes
+        }
+
+        // 5. Draw Particle Systems (last: blended over the finished scene, sky included)
+        if (particlePass) particlePass->Begin(sceneDepth);
+        contrails.Draw();
+        if (currentWeather != WeatherType::None) {
+            if (weatherSystem) weatherSystem->Draw(particleShader.ID, thirdPersonView);
+            else weatherVolume.Draw(particleShader.ID, thirdPersonCamPos);
+        }
+        if (particlePass) particlePass->End();
 
         window.swapBuffers();
     }
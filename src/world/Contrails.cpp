@@ -0,0 +1,106 @@
+#include "Contrails.h"
+#include "../graphics/Shader.h"
+#include <algorithm>
+
+Contrails::Contrails(int engineCount, int samplesPerEngine, float lifetime)
+    : m_EngineCount(engineCount), m_SamplesPerEngine(samplesPerEngine), m_Lifetime(lifetime),
+      m_SampleInterval(lifetime / (float)(samplesPerEngine - 1)), m_Trails(engineCount) {
+    // vec4 per sample: position, birth time
+    glGenBuffers(1, &m_SampleBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_SampleBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)engineCount * samplesPerEngine * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+    glGenTextures(1, &m_SampleTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, m_SampleTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_SampleBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // Vertices come from gl_VertexID, but core profile still wants a VAO bound
+    glGenVertexArrays(1, &m_EmptyVAO);
+    m_Shader = std::make_unique<Shader>("assets/shaders/contrail.vert", "assets/shaders/contrail.frag");
+    m_Shader->OnFinish([this] { SetupProgram(); });
+}
+
+Contrails::~Contrails() {
+    glDeleteTextures(1, &m_SampleTexture);
+    glDeleteBuffers(1, &m_SampleBuffer);
+    glDeleteVertexArrays(1, &m_EmptyVAO);
+}
+
+void Contrails::WriteSample(int engine, int slot, const glm::vec3& position, float birthTime) {
+    glm::vec4 sample(position, birthTime);
+    GLintptr offset = (GLintptr)((size_t)engine * m_SamplesPerEngine + slot) * sizeof(glm::vec4);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_SampleBuffer);
+    // The slot is either the newest sample or the oldest one, which has faded out; a draw from the
+    // previous frame still reading it is harmless, so do not let the driver wait for it
+    void* dst = glMapBufferRange(GL_TEXTURE_BUFFER, offset, sizeof(glm::vec4),
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dst) {
+        *static_cast<glm::vec4*>(dst) = sample;
+        glUnmapBuffer(GL_TEXTURE_BUFFER);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void Contrails::SetupProgram() {
+    m_Uniforms.trailTime = m_Shader->GetUniform("trailTime");
+    m_Uniforms.startWidth = m_Shader->GetUniform("startWidth");
+    m_Uniforms.endWidth = m_Shader->GetUniform("endWidth");
+    m_Uniforms.trailColor = m_Shader->GetUniform("trailColor");
+    m_Uniforms.base = m_Shader->GetUniform("base");
+    m_Uniforms.head = m_Shader->GetUniform("head");
+    m_Uniforms.count = m_Shader->GetUniform("count");
+    m_Shader->setFloat("lifetime", m_Lifetime);
+    m_Shader->setInt("ringSize", m_SamplesPerEngine);
+    m_Shader->setInt("samples", 0);
+}
+
+void Contrails::Update(float deltaTime, const std::vector<glm::vec3>& enginePositions) {
+    m_Time += deltaTime;
+    int engines = std::min(m_EngineCount, (int)enginePositions.size());
+    for (int e = 0; e < engines; ++e) {
+        EngineTrail& trail = m_Trails[e];
+        // Start a new sample once the newest one is a full interval old; otherwise drag it along
+        if (trail.count == 0 || m_Time - trail.headBirth >= m_SampleInterval) {
+            trail.head = (trail.count == 0) ? 0 : (trail.head + 1) % m_SamplesPerEngine;
+            trail.count = std::min(trail.count + 1, m_SamplesPerEngine);
+            trail.headBirth = m_Time;
+        }
+        WriteSample(e, trail.head, enginePositions[e], trail.headBirth);
+    }
+}
+
+void Contrails::Draw() {
+    glEnable(GL_BLEND);
+    // Alpha accumulates coverage, like ParticleSystem, so a LowResParticlePass can hold the ribbons
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    // The strip's winding flips wherever the trail turns past the camera
+    GLboolean cullEnabled = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_CULL_FACE);
+
+    Shader& shader = *m_Shader;
+    shader.use();
+    shader.setFloat(m_Uniforms.trailTime, m_Time);
+    shader.setFloat(m_Uniforms.startWidth, m_StartWidth);
+    shader.setFloat(m_Uniforms.endWidth, m_EndWidth);
+    shader.setVec4(m_Uniforms.trailColor, m_Color);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, m_SampleTexture);
+    glBindVertexArray(m_EmptyVAO);
+
+    for (int e = 0; e < m_EngineCount; ++e) {
+        const EngineTrail& trail = m_Trails[e];
+        if (trail.count < 2) continue;
+        shader.setInt(m_Uniforms.base, e * m_SamplesPerEngine);
+        shader.setInt(m_Uniforms.head, trail.head);
+        shader.setInt(m_Uniforms.count, trail.count);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, trail.count * 2);
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    if (cullEnabled) glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
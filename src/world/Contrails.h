@@ -0,0 +1,59 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+// Engine contrails as camera-facing ribbons. Each engine owns a fixed ring of samples (position
+// and birth time) in one GPU buffer, read by contrail.vert through a buffer texture: the vertex
+// shader expands sample i into the vertex pair 2i, 2i+1 of a triangle strip, so a trail costs
+// 2 * samplesPerEngine vertices and one draw call no matter how long it is. Per frame the CPU
+// writes one sample per engine: the newest sample follows the engine, and a new one is started
+// every lifetime / (samplesPerEngine - 1) seconds, so the full ring spans exactly the lifetime.
+class Contrails {
+public:
+    Contrails(int engineCount = 2, int samplesPerEngine = 128, float lifetime = 6.0f);
+    ~Contrails();
+
+    Contrails(const Contrails&) = delete;
+    Contrails& operator=(const Contrails&) = delete;
+
+    // enginePositions: one per engine, e.g. Plane::GetTrailPositions(); extra entries are ignored
+    void Update(float deltaTime, const std::vector<glm::vec3>& enginePositions);
+    // Seen from FrameData's follow camera
+    void Draw();
+
+    void SetWidth(float startWidth, float endWidth) { m_StartWidth = startWidth; m_EndWidth = endWidth; }
+    void SetColor(const glm::vec4& color) { m_Color = color; }
+
+private:
+    void WriteSample(int engine, int slot, const glm::vec3& position, float birthTime);
+    // Uniform lookups and constant uniforms; the shader runs it once the program has finished
+    // building (first Draw)
+    void SetupProgram();
+
+    int m_EngineCount;
+    int m_SamplesPerEngine;
+    float m_Lifetime;
+    float m_SampleInterval;
+    float m_Time = 0.0f;
+    float m_StartWidth = 0.6f;
+    float m_EndWidth = 5.0f;
+    glm::vec4 m_Color = glm::vec4(0.85f, 0.9f, 0.95f, 0.5f);
+
+    struct EngineTrail {
+        int head = 0;           // slot of the newest sample
+        int count = 0;          // samples written, up to samplesPerEngine
+        float headBirth = 0.0f; // birth time of the newest sample
+    };
+    std::vector<EngineTrail> m_Trails;
+
+    unsigned int m_SampleBuffer = 0;
+    unsigned int m_SampleTexture = 0;
+    unsigned int m_EmptyVAO = 0;
+    std::unique_ptr<class Shader> m_Shader;
+    struct Uniforms {
+        GLint trailTime = -1, startWidth = -1, endWidth = -1, trailColor = -1;
+        GLint base = -1, head = -1, count = -1;
+    } m_Uniforms;
+};
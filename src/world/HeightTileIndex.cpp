@@ -0,0 +1,112 @@
+#include "HeightTileIndex.h"
+#include "TerrainNoise.h"
+#include <cmath>
+#include <algorithm>
+#include <mutex>
+
+float HeightTile::Sample(float x, float z) const {
+    int cells = vertsPerSide - 1;
+    float fx = glm::clamp((x - originX) / spacing, 0.0f, (float)cells);
+    float fz = glm::clamp((z - originZ) / spacing, 0.0f, (float)cells);
+    int ix = std::min((int)fx, cells - 1);
+    int iz = std::min((int)fz, cells - 1);
+    float tx = fx - ix;
+    float tz = fz - iz;
+    const float* row0 = &heights[(size_t)iz * vertsPerSide + ix];
+    const float* row1 = row0 + vertsPerSide;
+    float a = row0[0] + (row0[1] - row0[0]) * tx;
+    float b = row1[0] + (row1[1] - row1[0]) * tx;
+    return a + (b - a) * tz;
+}
+
+namespace {
+
+std::atomic<uint64_t> s_NextGeneration(1);
+
+// Last level-0 chunk a thread resolved in GetHeight and the tile found for it (nullptr when
+// none was resident), valid while the generation it was found in is current
+struct HeightTileCache {
+    uint64_t generation = 0;
+    int cellX = 0, cellZ = 0;
+    std::shared_ptr<const HeightTile> tile;
+};
+thread_local HeightTileCache t_HeightTileCache;
+
+// floor(value / 2^shift) for negative values too
+int FloorShift(int value, int shift) {
+    return value >= 0 ? value >> shift : -((-value - 1) >> shift) - 1;
+}
+
+}
+
+HeightTileIndex::HeightTileIndex(int chunkSize, int lodLevels)
+    : m_ChunkSize(chunkSize), m_LodLevels(lodLevels) {
+    BumpGeneration();
+}
+
+void HeightTileIndex::BumpGeneration() {
+    m_Generation.store(s_NextGeneration.fetch_add(1), std::memory_order_release);
+}
+
+void HeightTileIndex::Insert(const ChunkKey& key, std::shared_ptr<const HeightTile> tile) {
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    m_Tiles[key] = std::move(tile);
+    BumpGeneration();
+}
+
+void HeightTileIndex::Erase(const ChunkKey& key) {
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+    if (m_Tiles.erase(key)) BumpGeneration();
+}
+
+const std::shared_ptr<const HeightTile>* HeightTileIndex::FindTile(int cellX, int cellZ) const {
+    for (int level = 0; level <= m_LodLevels; ++level) {
+        auto it = m_Tiles.find(ChunkKey{FloorShift(cellX, level), FloorShift(cellZ, level), level});
+        if (it != m_Tiles.end()) return &it->second;
+    }
+    return nullptr;
+}
+
+float HeightTileIndex::GetHeight(float x, float z) const {
+    // Repeated queries around one spot (ground collision) skip the lock and the map lookup
+    HeightTileCache& cache = t_HeightTileCache;
+    uint64_t generation = m_Generation.load(std::memory_order_acquire);
+    int cellX = (int)std::floor(x / m_ChunkSize);
+    int cellZ = (int)std::floor(z / m_ChunkSize);
+    if (cache.generation != generation || cache.cellX != cellX || cache.cellZ != cellZ) {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+        const std::shared_ptr<const HeightTile>* tile = FindTile(cellX, cellZ);
+        cache.tile = tile ? *tile : nullptr;
+        cache.generation = generation;
+        cache.cellX = cellX;
+        cache.cellZ = cellZ;
+    }
+    return cache.tile ? cache.tile->Sample(x, z) : TerrainNoise::Fbm(x, z);
+}
+
+void HeightTileIndex::GetHeights(const glm::vec2* positions, float* outHeights, size_t count) const {
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    // Queries tend to be spatially coherent, so reuse the lookup while they stay in one chunk
+    const HeightTile* tile = nullptr;
+    int lastX = 0, lastZ = 0;
+    bool haveLast = false;
+    for (size_t i = 0; i < count; ++i) {
+        float x = positions[i].x;
+        float z = positions[i].y;
+        int cellX = (int)std::floor(x / m_ChunkSize);
+        int cellZ = (int)std::floor(z / m_ChunkSize);
+        if (!haveLast || cellX != lastX || cellZ != lastZ) {
+            const std::shared_ptr<const HeightTile>* found = FindTile(cellX, cellZ);
+            tile = found ? found->get() : nullptr;
+            lastX = cellX;
+            lastZ = cellZ;
+            haveLast = true;
+        }
+        outHeights[i] = tile ? tile->Sample(x, z) : TerrainNoise::Fbm(x, z);
+    }
+}
+
+size_t HeightTileIndex::GetTileCount() const {
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+    return m_Tiles.size();
+}
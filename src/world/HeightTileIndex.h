@@ -0,0 +1,71 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <shared_mutex>
+#include <atomic>
+
+// Quadtree node coordinates. A level-L node covers 2^L x 2^L level-0 chunks
+// (chunkSize << L world units) with the same number of vertices as a level-0 chunk,
+// so its grid spacing is 2^L units. x/z are in units of that node size.
+struct ChunkKey {
+    int x, z;
+    int level = 0;
+    bool operator==(const ChunkKey& other) const {
+        return x == other.x && z == other.z && level == other.level;
+    }
+};
+
+// Hash for chunk coordinates; each component is scaled by a large odd constant so
+// neighbouring keys spread over the whole range
+struct ChunkKeyHash {
+    size_t operator()(const ChunkKey& k) const {
+        uint32_t h = (uint32_t)k.x * 73856093u ^ (uint32_t)k.z * 19349663u ^ (uint32_t)k.level * 83492791u;
+        return (size_t)(h ^ (h >> 15));
+    }
+};
+
+// Heights of one node on its vertex grid, kept while the node is resident so height queries
+// can be answered without evaluating the noise. Immutable once built, so it can be read from
+// any thread through a shared_ptr.
+struct HeightTile {
+    float originX, originZ;
+    float spacing;
+    int vertsPerSide;
+    std::vector<float> heights;
+
+    // Bilinear interpolation between the grid vertices (clamped to the tile)
+    float Sample(float x, float z) const;
+};
+
+// Resident height tiles by node key. Queries resolve to the finest resident tile over the
+// point, falling back to the noise where there is none. Every node covers whole level-0
+// chunks, so that tile is the same for all points of one level-0 chunk; the per-thread cache
+// is keyed on that chunk and the answer never depends on earlier queries.
+// Insert/Erase are meant for one writer thread; the queries are safe from any thread.
+class HeightTileIndex {
+public:
+    HeightTileIndex(int chunkSize, int lodLevels);
+
+    void Insert(const ChunkKey& key, std::shared_ptr<const HeightTile> tile);
+    void Erase(const ChunkKey& key);
+
+    float GetHeight(float x, float z) const;
+    void GetHeights(const glm::vec2* positions, float* outHeights, size_t count) const;
+    size_t GetTileCount() const;
+
+private:
+    int m_ChunkSize;
+    int m_LodLevels;
+    mutable std::shared_mutex m_Mutex;
+    std::unordered_map<ChunkKey, std::shared_ptr<const HeightTile>, ChunkKeyHash> m_Tiles;
+    // Changes (to a value unique across all indices) whenever m_Tiles does; lets GetHeight
+    // reuse a thread's last lookup without taking the lock
+    std::atomic<uint64_t> m_Generation;
+
+    // Finest resident tile over level-0 chunk (cellX, cellZ), or nullptr; caller holds m_Mutex
+    const std::shared_ptr<const HeightTile>* FindTile(int cellX, int cellZ) const;
+    void BumpGeneration();
+};
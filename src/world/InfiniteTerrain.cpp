@@ -1,14 +1,130 @@
 #include <iostream>
 #include <stb_image.h>
 #include "InfiniteTerrain.h"
+#include "TerrainNoise.h"
+#include "TerrainTileCache.h"
 #include <glad/glad.h>
 #include <cmath>
+#include <algorithm>
+#include <chrono>
+#include "../core/ThreadPool.h"
+#include "../graphics/ChunkBufferPool.h"
+#include "../graphics/Frustum.h"
 #include "../graphics/Shader.h"
 #include <glm/gtc/matrix_transform.hpp>
 
-InfiniteTerrain::InfiniteTerrain(int chunkSize, int viewDistance)
-    : m_ChunkSize(chunkSize), m_ViewDistance(viewDistance) {
+namespace {
+
+// Floor division by a positive divisor (chunk coordinates go negative)
+int FloorDiv(int value, int divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// Distance from c to the closed range [lo, hi] along one axis
+int AxisDistance(int c, int lo, int hi) {
+    if (c < lo) return lo - c;
+    if (c > hi) return c - hi;
+    return 0;
+}
+
+// Grid vertex index of the i-th vertex along a chunk edge. Edges are walked so the skirt
+// triangles built from them face outwards: z = 0 along +x, x = n along +z,
+// z = n along -x, x = 0 along -z.
+int EdgeVertexIndex(int edge, int i, int n) {
+    int vertsPerRow = n + 1;
+    switch (edge) {
+        case 0: return i;
+        case 1: return i * vertsPerRow + n;
+        case 2: return n * vertsPerRow + (n - i);
+        default: return (n - i) * vertsPerRow;
+    }
+}
+
+}
+
+InfiniteTerrain::InfiniteTerrain(int chunkSize, int viewDistance, int lodLevels, ThreadPool* workers)
+    : m_ChunkSize(chunkSize), m_ViewDistance(viewDistance), m_LodLevels(lodLevels), m_Workers(workers) {
+    if (!m_Workers) {
+        m_OwnedWorkers = std::make_unique<ThreadPool>();
+        m_Workers = m_OwnedWorkers.get();
+    }
+    // Vertex indices within a chunk (grid + skirt) must fit the shared 16-bit index buffer
+    if ((m_ChunkSize + 1) * (m_ChunkSize + 5) > 65536) {
+        std::cerr << "[InfiniteTerrain] Chunk size " << m_ChunkSize << " too large for 16-bit indices, clamping to 253" << std::endl;
+        m_ChunkSize = 253;
+    }
+    // Vertex x/z offsets are uint16 world units, so a node may be at most 65535 units wide
+    m_LodLevels = std::max(0, m_LodLevels);
+    while (m_LodLevels > 0 && (m_ChunkSize << m_LodLevels) > 65535) {
+        m_LodLevels--;
+    }
+    // Selected nodes of one level lie within viewDistance + 1 of the camera's node, and their
+    // fallback children within 2 * viewDistance + 3 of the camera's child node. A window twice
+    // as wide keeps both apart from each other's cells.
+    int gridSide = 1;
+    while (gridSide < 2 * (2 * m_ViewDistance + 3)) gridSide <<= 1;
+    m_Grid.Reset(m_LodLevels + 1, gridSide);
+    m_BuildQueue = std::make_shared<ChunkBuildQueue>();
+    m_HeightTiles = std::make_unique<HeightTileIndex>(m_ChunkSize, m_LodLevels);
     LoadTerrainTextures();
+    InitRenderData();
+    std::cout << "[InfiniteTerrain] " << (m_LodLevels + 1) << " LOD levels, visible radius "
+              << GetVisibleRadius() << " units" << std::endl;
+}
+
+void InfiniteTerrain::InitRenderData() {
+    // (n+1)^2 grid vertices followed by one skirt vertex per edge vertex
+    m_VerticesPerChunk = (m_ChunkSize + 1) * (m_ChunkSize + 1) + 4 * (m_ChunkSize + 1);
+    
+    // The selection size only depends on where the camera sits inside its coarsest node,
+    // so the worst case over those positions bounds the working set. Half as many slots
+    // again hold fallback and recently dropped nodes.
+    int period = 1 << m_LodLevels;
+    size_t maxSelected = 0;
+    std::vector<ChunkKey> selection;
+    for (int z = 0; z < period; ++z) {
+        for (int x = 0; x < period; ++x) {
+            SelectNodes(x, z, selection);
+            maxSelected = std::max(maxSelected, selection.size());
+        }
+    }
+    int slotCount = (int)(maxSelected + maxSelected / 2);
+    m_SlotCount = slotCount;
+    m_BufferPool = std::make_unique<ChunkBufferPool>(m_VerticesPerChunk * sizeof(TerrainVertex), slotCount);
+    
+    std::vector<uint16_t> indices = BuildChunkIndices(m_ChunkSize);
+    m_IndexCount = (int)indices.size();
+    
+    glGenVertexArrays(1, &m_VAO);
+    glBindVertexArray(m_VAO);
+    
+    glGenBuffers(1, &m_IndexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+    
+    glBindBuffer(GL_ARRAY_BUFFER, m_BufferPool->GetBuffer());
+    // Local position (location 0)
+    glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(TerrainVertex), (void*)offsetof(TerrainVertex, x));
+    glEnableVertexAttribArray(0);
+    // Height (location 1)
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(TerrainVertex), (void*)offsetof(TerrainVertex, height));
+    glEnableVertexAttribArray(1);
+    // Normal x/z (location 2)
+    glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(TerrainVertex), (void*)offsetof(TerrainVertex, nx));
+    glEnableVertexAttribArray(2);
+    
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // Chunk origins indexed by pool slot, read in the vertex shader through texelFetch
+    glGenBuffers(1, &m_ChunkInfoBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_ChunkInfoBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)slotCount * 4 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glGenTextures(1, &m_ChunkInfoTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, m_ChunkInfoTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_ChunkInfoBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
 }
 
 // 加载贴图工具
@@ -101,140 +217,236 @@ void InfiniteTerrain::LoadTerrainTextures() {
 }
 
 InfiniteTerrain::~InfiniteTerrain() {
-    for (auto& pair : m_Chunks) {
-        glDeleteVertexArrays(1, &pair.second.VAO);
-        glDeleteBuffers(1, &pair.second.VBO);
-        glDeleteBuffers(1, &pair.second.EBO);
-    }
-}
-
-// --- 更仿真的分形布朗运动（fbm）噪声 ---
-// 基础伪随机hash
-static float hash(float n) {
-    return std::fmod(std::sin(n) * 43758.5453f, 1.0f);
-}
-
-// 2D value noise
-static float valueNoise(float x, float z) {
-    int ix = (int)std::floor(x);
-    int iz = (int)std::floor(z);
-    float fx = x - ix;
-    float fz = z - iz;
-    // 四角hash
-    float v00 = hash(ix * 49632 + iz * 325176);
-    float v10 = hash((ix+1) * 49632 + iz * 325176);
-    float v01 = hash(ix * 49632 + (iz+1) * 325176);
-    float v11 = hash((ix+1) * 49632 + (iz+1) * 325176);
-    // 双线性插值
-    float u = fx * fx * (3.0f - 2.0f * fx);
-    float v = fz * fz * (3.0f - 2.0f * fz);
-    float a = v00 * (1-u) + v10 * u;
-    float b = v01 * (1-u) + v11 * u;
-    return a * (1-v) + b * v;
-}
-
-// fbm多层叠加
-float InfiniteTerrain::Noise(float x, float z) const {
-    float amplitude = 1.0f;
-    float frequency = 0.005f;
-    float maxAmp = 0.0f;
-    float sum = 0.0f;
-    for (int i = 0; i < 6; ++i) {
-        sum += valueNoise(x * frequency, z * frequency) * amplitude;
-        maxAmp += amplitude;
-        amplitude *= 0.5f;
-        frequency *= 2.0f;
-    }
-    // 控制地形起伏
-    return sum / maxAmp * 100.0f - 10.0f;
-}
-
-glm::vec3 InfiniteTerrain::GetTerrainColor(float height) const {
-    // 更真实的分层与颜色，增加坡度影响
-    // 这里不直接用坡度，但为shader细节做准备
-    if (height > 70.0f) {
-        // 雪山顶
-        return glm::vec3(0.97f, 0.97f, 0.99f);
-    } else if (height > 55.0f) {
-        // 雪与岩石过渡
-        float t = (height - 55.0f) / 15.0f;
-        return glm::mix(glm::vec3(0.7f, 0.7f, 0.75f), glm::vec3(0.97f, 0.97f, 0.99f), t);
-    } else if (height > 40.0f) {
-        // 岩石山体
-        float t = (height - 40.0f) / 15.0f;
-        return glm::mix(glm::vec3(0.5f, 0.4f, 0.35f), glm::vec3(0.7f, 0.7f, 0.75f), t);
-    } else if (height > 25.0f) {
-        // 森林（深绿）
-        float t = (height - 25.0f) / 15.0f;
-        return glm::mix(glm::vec3(0.18f, 0.32f, 0.13f), glm::vec3(0.2f, 0.4f, 0.15f), t);
-    } else if (height > 8.0f) {
-        // 草地（鲜绿）
-        float t = (height - 8.0f) / 17.0f;
-        return glm::mix(glm::vec3(0.36f, 0.7f, 0.22f), glm::vec3(0.18f, 0.32f, 0.13f), t);
-    } else if (height > 0.0f) {
-        // 低地草原
-        return glm::vec3(0.36f, 0.7f, 0.22f);
-    } else if (height > -4.0f) {
-        // 沙滩
-        return glm::vec3(0.85f, 0.8f, 0.55f);
-    } else {
-        // 水体
-        return glm::vec3(0.13f, 0.32f, 0.65f);
+    // Jobs still queued on a shared pool see this and drop their result
+    {
+        std::lock_guard<std::mutex> lock(m_BuildQueue->mutex);
+        m_BuildQueue->cancelled = true;
+        m_BuildQueue->completed.clear();
+    }
+    glDeleteVertexArrays(1, &m_VAO);
+    glDeleteBuffers(1, &m_IndexBuffer);
+    glDeleteTextures(1, &m_ChunkInfoTexture);
+    glDeleteBuffers(1, &m_ChunkInfoBuffer);
+    if (m_HeightTexture) {
+        glDeleteTextures(1, &m_HeightTexture);
+        glDeleteFramebuffers(1, &m_BakeFramebuffer);
+        glDeleteVertexArrays(1, &m_BakeVAO);
+        glDeleteVertexArrays(1, &m_GridVAO);
+        glDeleteBuffers(1, &m_GridBuffer);
+        glDeleteBuffers(1, &m_InstanceBuffer);
+    }
+}
+
+void InfiniteTerrain::InitGpuRenderData() {
+    int tileSize = m_ChunkSize + 3;
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    int layerCount = std::min(m_SlotCount, (int)maxLayers);
+    
+    glGenTextures(1, &m_HeightTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_HeightTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, tileSize, tileSize, layerCount, 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    for (int i = layerCount - 1; i >= 0; --i) {
+        m_FreeLayers.push_back(i);
+    }
+    
+    glGenFramebuffers(1, &m_BakeFramebuffer);
+    glGenVertexArrays(1, &m_BakeVAO);
+    m_BakeShader = std::make_unique<Shader>("assets/shaders/fullscreen.vert", "assets/shaders/terrain_height_bake.frag");
+    // Looked up once the program has built (first bake), so startup does not wait for it
+    m_BakeShader->OnFinish([this] {
+        m_BakeUniforms.nodeOrigin = m_BakeShader->GetUniform("nodeOrigin");
+        m_BakeUniforms.spacing = m_BakeShader->GetUniform("spacing");
+        m_BakeUniforms.noiseSeed = m_BakeShader->GetUniform("noiseSeed");
+    });
+    
+    // Flat grid in the same vertex order as a CPU mesh (grid rows, then the four skirt edges),
+    // so the shared index buffer applies unchanged
+    int vertsPerSide = m_ChunkSize + 1;
+    std::vector<uint8_t> grid;
+    grid.reserve((size_t)m_VerticesPerChunk * 4);
+    for (int z = 0; z <= m_ChunkSize; ++z) {
+        for (int x = 0; x <= m_ChunkSize; ++x) {
+            grid.insert(grid.end(), { (uint8_t)x, (uint8_t)z, 0, 0 });
+        }
+    }
+    for (int edge = 0; edge < 4; ++edge) {
+        for (int i = 0; i <= m_ChunkSize; ++i) {
+            int index = EdgeVertexIndex(edge, i, m_ChunkSize);
+            grid.insert(grid.end(), { (uint8_t)(index % vertsPerSide), (uint8_t)(index / vertsPerSide), 1, 0 });
+        }
+    }
+    
+    glGenVertexArrays(1, &m_GridVAO);
+    glBindVertexArray(m_GridVAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer);
+    glGenBuffers(1, &m_GridBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_GridBuffer);
+    glBufferData(GL_ARRAY_BUFFER, grid.size(), grid.data(), GL_STATIC_DRAW);
+    // Grid x, grid z, skirt flag (location 0)
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_BYTE, GL_FALSE, 4, (void*)0);
+    glEnableVertexAttribArray(0);
+    // Slot per instance (location 1)
+    glGenBuffers(1, &m_InstanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)layerCount * sizeof(int), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribIPointer(1, 1, GL_INT, sizeof(int), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    std::cout << "[InfiniteTerrain] GPU heightmap: " << layerCount << " layers of " << tileSize << "x" << tileSize << std::endl;
+}
+
+void InfiniteTerrain::SetMode(TerrainMode mode) {
+    if (mode == m_Mode) return;
+    if (mode == TerrainMode::GpuHeightmap && !m_HeightTexture) {
+        InitGpuRenderData();
+    }
+    // Release with the old mode's allocator before switching
+    for (ChunkGridCell& cell : m_Grid.Cells()) {
+        if (cell.resident) ReleaseChunk(cell);
+    }
+    m_Fallbacks.clear();
+    m_DrawList.clear();
+    m_VisibleSlots.clear();
+    m_ReadyToUpload.clear();
+    for (auto& pair : m_Requests) {
+        if (pair.second.cancelled) pair.second.cancelled->store(true, std::memory_order_relaxed);
+    }
+    m_Requests.clear();
+    m_StreamOrder.clear();
+    {
+        // Jobs still in flight may add a few meshes later; they are uploaded if still wanted
+        std::lock_guard<std::mutex> lock(m_BuildQueue->mutex);
+        m_BuildQueue->completed.clear();
     }
+    m_SelectionChanged = true;
+    m_Mode = mode;
+    std::cout << "[InfiniteTerrain] Mode: " << (m_Mode == TerrainMode::GpuHeightmap ? "GPU heightmap" : "CPU mesh") << std::endl;
 }
 
 float InfiniteTerrain::GetHeight(float x, float z) const {
-    return Noise(x, z);
+    return m_HeightTiles->GetHeight(x, z);
+}
+
+void InfiniteTerrain::GetHeights(const glm::vec2* positions, float* outHeights, size_t count) const {
+    m_HeightTiles->GetHeights(positions, outHeights, count);
+}
+
+size_t InfiniteTerrain::GetHeightTileCount() const {
+    return m_HeightTiles->GetTileCount();
+}
+
+glm::vec3 InfiniteTerrain::NormalFromSlope(float dHdx, float dHdz) {
+    // 高度场 y = h(x, z) 的法线为 (-dh/dx, 1, -dh/dz)
+    return glm::normalize(glm::vec3(-dHdx, 1.0f, -dHdz));
 }
 
-TerrainChunk InfiniteTerrain::GenerateChunk(int chunkX, int chunkZ) {
-    TerrainChunk chunk;
-    chunk.worldPos = glm::vec3(chunkX * m_ChunkSize, 0, chunkZ * m_ChunkSize);
+glm::vec3 InfiniteTerrain::GetNormal(float x, float z) const {
+    float dHdx, dHdz;
+    TerrainNoise::FbmDerivatives(x, z, &dHdx, &dHdz);
+    return NormalFromSlope(dHdx, dHdz);
+}
+
+float InfiniteTerrain::SkirtDepth(int level) {
+    // Deep enough to cover the height error between neighbouring levels at that spacing
+    return 2.0f + 2.0f * (float)(1 << level);
+}
+
+void InfiniteTerrain::EnableDiskCache(const std::string& path, size_t maxBytes) {
+    // Tiles are keyed by seed and noise configuration, so switching either never reuses stale data
+    auto cache = std::make_shared<TerrainTileCache>(path, maxBytes, m_ChunkSize + 1, TerrainNoise::GetSeed(), TerrainNoise::ParamsHash());
+    m_DiskCache = cache->IsOpen() ? cache : nullptr;
+}
+
+ChunkMeshData InfiniteTerrain::BuildChunkMesh(const ChunkKey& key, int chunkSize, TerrainTileCache* diskCache) {
+    ChunkMeshData mesh;
+    mesh.key = key;
     
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
+    // Same vertex count at every level; only the spacing grows
+    int spacing = 1 << key.level;
+    int nodeSize = chunkSize * spacing;
+    float worldOffsetX = (float)key.x * nodeSize;
+    float worldOffsetZ = (float)key.z * nodeSize;
     
-    float worldOffsetX = chunkX * m_ChunkSize;
-    float worldOffsetZ = chunkZ * m_ChunkSize;
+    int vertsPerSide = chunkSize + 1;
+    size_t gridVertexCount = (size_t)vertsPerSide * vertsPerSide;
+    std::vector<float> heights(gridVertexCount);
+    std::vector<int16_t> normals(gridVertexCount * 2);
+    if (!diskCache || !diskCache->Load(key, heights.data(), normals.data())) {
+        // Heights and analytic slopes for the whole chunk in one batched pass
+        std::vector<float> slopeX(gridVertexCount), slopeZ(gridVertexCount);
+        TerrainNoise::FbmGridDerivatives(worldOffsetX, worldOffsetZ, (float)spacing, vertsPerSide, vertsPerSide,
+                                         heights.data(), slopeX.data(), slopeZ.data());
+        // Normal from the noise derivatives (same at a shared border vertex in both chunks)
+        for (size_t i = 0; i < gridVertexCount; ++i) {
+            glm::vec3 normal = NormalFromSlope(slopeX[i], slopeZ[i]);
+            normals[i * 2] = (int16_t)std::lround(normal.x * 32767.0f);
+            normals[i * 2 + 1] = (int16_t)std::lround(normal.z * 32767.0f);
+        }
+        if (diskCache) diskCache->Store(key, heights.data(), normals.data());
+    }
+    
+    // Height range for the chunk's bounding box, down to the bottom of the skirt
+    float skirtDepth = SkirtDepth(key.level);
+    auto range = std::minmax_element(heights.begin(), heights.end());
+    mesh.minHeight = *range.first - skirtDepth;
+    mesh.maxHeight = *range.second;
     
     // Generate vertices
-    for (int z = 0; z <= m_ChunkSize; ++z) {
-        for (int x = 0; x <= m_ChunkSize; ++x) {
-            float worldX = worldOffsetX + x;
-            float worldZ = worldOffsetZ + z;
-            float height = Noise(worldX, worldZ);
-            
-            // Position
-            vertices.push_back(worldX);
-            vertices.push_back(height);
-            vertices.push_back(worldZ);
-            
-            // Calculate normal using central differences
-            float hL = Noise(worldX - 1, worldZ);
-            float hR = Noise(worldX + 1, worldZ);
-            float hD = Noise(worldX, worldZ - 1);
-            float hU = Noise(worldX, worldZ + 1);
-            glm::vec3 normal = glm::normalize(glm::vec3(hL - hR, 2.0f, hD - hU));
-            vertices.push_back(normal.x);
-            vertices.push_back(normal.y);
-            vertices.push_back(normal.z);
-            
-            // Color based on height
-            glm::vec3 color = GetTerrainColor(height);
-            vertices.push_back(color.r);
-            vertices.push_back(color.g);
-            vertices.push_back(color.b);
+    mesh.vertices.resize(gridVertexCount + 4 * (size_t)vertsPerSide);
+    for (int z = 0; z <= chunkSize; ++z) {
+        for (int x = 0; x <= chunkSize; ++x) {
+            size_t i = (size_t)z * vertsPerSide + x;
+            TerrainVertex& vertex = mesh.vertices[i];
+            vertex.x = (uint16_t)(x * spacing);
+            vertex.z = (uint16_t)(z * spacing);
+            vertex.height = heights[i];
+            vertex.nx = normals[i * 2];
+            vertex.nz = normals[i * 2 + 1];
+        }
+    }
+    
+    // Skirt: a copy of each edge vertex pushed straight down. A finer neighbour's edge has
+    // vertices between ours, and the skirt fills the T-junction gaps this leaves.
+    size_t skirtBase = gridVertexCount;
+    for (int edge = 0; edge < 4; ++edge) {
+        for (int i = 0; i <= chunkSize; ++i) {
+            TerrainVertex vertex = mesh.vertices[EdgeVertexIndex(edge, i, chunkSize)];
+            vertex.height -= skirtDepth;
+            mesh.vertices[skirtBase + (size_t)edge * vertsPerSide + i] = vertex;
         }
     }
     
-    // Generate indices
-    int vertsPerRow = m_ChunkSize + 1;
-    for (int z = 0; z < m_ChunkSize; ++z) {
-        for (int x = 0; x < m_ChunkSize; ++x) {
-            unsigned int topLeft = z * vertsPerRow + x;
-            unsigned int topRight = topLeft + 1;
-            unsigned int bottomLeft = (z + 1) * vertsPerRow + x;
-            unsigned int bottomRight = bottomLeft + 1;
+    // The height grid is kept for GetHeight while the node is resident
+    auto tile = std::make_shared<HeightTile>();
+    tile->originX = worldOffsetX;
+    tile->originZ = worldOffsetZ;
+    tile->spacing = (float)spacing;
+    tile->vertsPerSide = vertsPerSide;
+    tile->heights = std::move(heights);
+    mesh.heightTile = std::move(tile);
+    
+    return mesh;
+}
+
+std::vector<uint16_t> InfiniteTerrain::BuildChunkIndices(int chunkSize) {
+    std::vector<uint16_t> indices;
+    indices.reserve((size_t)chunkSize * chunkSize * 6 + (size_t)chunkSize * 24);
+    int vertsPerRow = chunkSize + 1;
+    for (int z = 0; z < chunkSize; ++z) {
+        for (int x = 0; x < chunkSize; ++x) {
+            uint16_t topLeft = (uint16_t)(z * vertsPerRow + x);
+            uint16_t topRight = (uint16_t)(topLeft + 1);
+            uint16_t bottomLeft = (uint16_t)((z + 1) * vertsPerRow + x);
+            uint16_t bottomRight = (uint16_t)(bottomLeft + 1);
             
             indices.push_back(topLeft);
             indices.push_back(bottomLeft);
@@ -246,85 +458,578 @@ TerrainChunk InfiniteTerrain::GenerateChunk(int chunkX, int chunkZ) {
         }
     }
     
-    chunk.indexCount = indices.size();
-    
-    glGenVertexArrays(1, &chunk.VAO);
-    glGenBuffers(1, &chunk.VBO);
-    glGenBuffers(1, &chunk.EBO);
+    // Skirt quads between each edge and its lowered copy, facing away from the chunk
+    int skirtBase = vertsPerRow * vertsPerRow;
+    for (int edge = 0; edge < 4; ++edge) {
+        for (int i = 0; i < chunkSize; ++i) {
+            uint16_t top0 = (uint16_t)EdgeVertexIndex(edge, i, chunkSize);
+            uint16_t top1 = (uint16_t)EdgeVertexIndex(edge, i + 1, chunkSize);
+            uint16_t bottom0 = (uint16_t)(skirtBase + edge * vertsPerRow + i);
+            uint16_t bottom1 = (uint16_t)(bottom0 + 1);
+            
+            indices.push_back(top0);
+            indices.push_back(top1);
+            indices.push_back(bottom0);
+            
+            indices.push_back(bottom0);
+            indices.push_back(top1);
+            indices.push_back(bottom1);
+        }
+    }
+    return indices;
+}
+
+bool InfiniteTerrain::UploadChunk(const ChunkMeshData& mesh, TerrainChunk& chunk) {
+    chunk.slot = m_BufferPool->Acquire();
+    if (chunk.slot < 0) return false;
+    chunk.size = (float)(m_ChunkSize << mesh.key.level);
+    chunk.worldPos = glm::vec3(mesh.key.x * chunk.size, 0, mesh.key.z * chunk.size);
+    chunk.minHeight = mesh.minHeight;
+    chunk.maxHeight = mesh.maxHeight;
+    m_BufferPool->Upload(chunk.slot, mesh.vertices.data(), mesh.vertices.size() * sizeof(TerrainVertex));
+    WriteChunkInfo(chunk, mesh.key.level);
+    return true;
+}
+
+void InfiniteTerrain::WriteChunkInfo(const TerrainChunk& chunk, int level) {
+    float info[4] = { chunk.worldPos.x, chunk.worldPos.z, chunk.size, SkirtDepth(level) };
+    glBindBuffer(GL_TEXTURE_BUFFER, m_ChunkInfoBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, (GLintptr)chunk.slot * sizeof(info), sizeof(info), info);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void InfiniteTerrain::ReleaseChunk(ChunkGridCell& cell) {
+    m_HeightTiles->Erase(cell.key);
+    if (m_Mode == TerrainMode::GpuHeightmap) {
+        m_FreeLayers.push_back(cell.chunk.slot);
+    } else {
+        m_BufferPool->Release(cell.chunk.slot);
+    }
+    cell.resident = false;
+    m_ResidentCount--;
+    m_ResidentChanged = true;
+}
+
+ChunkGridCell& InfiniteTerrain::ClaimCell(const ChunkKey& key) {
+    ChunkGridCell& cell = m_Grid.CellFor(key);
+    if (!(cell.key == key)) {
+        // Only a node that left the window can be here, never a selected one
+        if (cell.resident) ReleaseChunk(cell);
+        cell.key = key;
+        cell.selected = false;
+    }
+    return cell;
+}
+
+void InfiniteTerrain::SetResident(const ChunkKey& key, const TerrainChunk& chunk) {
+    ChunkGridCell& cell = ClaimCell(key);
+    if (!cell.resident) m_ResidentCount++;
+    cell.chunk = chunk;
+    cell.resident = true;
+    m_ResidentChanged = true;
+}
+
+void InfiniteTerrain::BakeMissingChunks() {
+    // The bake pass renders into the height array; restore the caller's target afterwards
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    GLboolean blendEnabled = glIsEnabled(GL_BLEND);
+    GLboolean depthEnabled = glIsEnabled(GL_DEPTH_TEST);
+    bool stateChanged = false;
     
-    glBindVertexArray(chunk.VAO);
+    int tileSize = m_ChunkSize + 3;
+    // The Legacy hash is sin() of large arguments, which GPUs do not reduce like the C library;
+    // fill those layers from the CPU evaluator instead so they match GetHeight and CpuMesh
+    bool cpuBake = TerrainNoise::GetBackend() == TerrainNoise::NoiseBackend::Legacy;
+    std::vector<float> heights;
+    if (cpuBake) heights.resize((size_t)tileSize * tileSize);
+    int baked = 0;
+    for (const ChunkKey& key : m_StreamOrder) {
+        if (baked >= m_BakeBudget) break;
+        if (m_FreeLayers.empty() && !EvictCachedChunk()) break;
+        
+        if (!cpuBake && !stateChanged) {
+            glBindFramebuffer(GL_FRAMEBUFFER, m_BakeFramebuffer);
+            glViewport(0, 0, tileSize, tileSize);
+            glDisable(GL_BLEND);
+            glDisable(GL_DEPTH_TEST);
+            m_BakeShader->use();
+            glBindVertexArray(m_BakeVAO);
+            stateChanged = true;
+        }
+        
+        TerrainChunk chunk;
+        chunk.slot = m_FreeLayers.back();
+        m_FreeLayers.pop_back();
+        chunk.size = (float)(m_ChunkSize << key.level);
+        chunk.worldPos = glm::vec3(key.x * chunk.size, 0, key.z * chunk.size);
+        // Heights stay on the GPU, so the box uses the noise's global range
+        chunk.minHeight = TerrainNoise::MinHeight - SkirtDepth(key.level);
+        chunk.maxHeight = TerrainNoise::MaxHeight;
+        
+        float spacing = (float)(1 << key.level);
+        if (cpuBake) {
+            // Same texel layout as the bake shader: a one-texel border around the node's grid
+            TerrainNoise::FbmGrid(chunk.worldPos.x - spacing, chunk.worldPos.z - spacing, spacing,
+                                  tileSize, tileSize, heights.data());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, m_HeightTexture);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, chunk.slot, tileSize, tileSize, 1,
+                            GL_RED, GL_FLOAT, heights.data());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        } else {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_HeightTexture, 0, chunk.slot);
+            m_BakeShader->setVec2(m_BakeUniforms.nodeOrigin, glm::vec2(chunk.worldPos.x, chunk.worldPos.z));
+            m_BakeShader->setFloat(m_BakeUniforms.spacing, spacing);
+            m_BakeShader->setInt(m_BakeUniforms.noiseSeed, (int)TerrainNoise::GetSeed());
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        
+        WriteChunkInfo(chunk, key.level);
+        SetResident(key, chunk);
+        CompleteStreamRequest(key);
+        baked++;
+    }
     
-    glBindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    if (stateChanged) {
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+        if (blendEnabled) glEnable(GL_BLEND);
+        if (depthEnabled) glEnable(GL_DEPTH_TEST);
+    }
+}
+
+float InfiniteTerrain::StreamPriority(const ChunkKey& key) const {
+    // Distance from the camera to the nearest point of the node, so a large coarse node the
+    // camera is close to is not ranked by its far-away centre
+    float size = (float)(m_ChunkSize << key.level);
+    glm::vec2 camera(m_CameraPos.x, m_CameraPos.z);
+    glm::vec2 nodeMin((float)key.x * size, (float)key.z * size);
+    glm::vec2 toNode = glm::clamp(camera, nodeMin, nodeMin + size) - camera;
+    float distance = glm::length(toNode);
     
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    // Shrink the distance of nodes along the flight direction and stretch it behind. The
+    // weight fades in until the camera crosses a full-detail chunk per second.
+    glm::vec2 velocity(m_CameraVelocity.x, m_CameraVelocity.z);
+    float speed = glm::length(velocity);
+    if (distance > 0.0f && speed > 1e-3f) {
+        float alignment = glm::dot(toNode / distance, velocity / speed);
+        float weight = m_StreamHeadingWeight * std::min(1.0f, speed / (float)m_ChunkSize);
+        distance *= 1.0f - weight * alignment;
+    }
+    return distance;
+}
+
+void InfiniteTerrain::UpdateStreamRequests() {
+    if (m_SelectionChanged) {
+        // Nodes that left the range: forget them and skip their job if it has not started
+        for (auto it = m_Requests.begin(); it != m_Requests.end();) {
+            if (m_Grid.IsSelected(it->first)) {
+                ++it;
+                continue;
+            }
+            if (it->second.cancelled) it->second.cancelled->store(true, std::memory_order_relaxed);
+            m_StreamStats.cancelledThisFrame++;
+            it = m_Requests.erase(it);
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        m_StreamOrder.clear();
+        for (const ChunkKey& key : m_Selected) {
+            if (m_Grid.IsResident(key)) continue;
+            auto inserted = m_Requests.emplace(key, ChunkStreamRequest());
+            if (inserted.second) inserted.first->second.wantedSince = now;
+            m_StreamOrder.push_back(key);
+        }
+    } else {
+        // Same selection: only nodes that became resident drop out
+        m_StreamOrder.erase(std::remove_if(m_StreamOrder.begin(), m_StreamOrder.end(), [this](const ChunkKey& key) {
+            return !m_Requests.count(key);
+        }), m_StreamOrder.end());
+    }
+    if (m_StreamOrder.empty()) return;
     
-    // Position (location 0)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Normal (location 1)
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // Color (location 2)
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    // The camera moves every frame, so every request is re-ranked
+    for (const ChunkKey& key : m_StreamOrder) {
+        m_Requests.at(key).priority = StreamPriority(key);
+    }
+    std::sort(m_StreamOrder.begin(), m_StreamOrder.end(), [this](const ChunkKey& a, const ChunkKey& b) {
+        return m_Requests.at(a).priority < m_Requests.at(b).priority;
+    });
+}
+
+void InfiniteTerrain::SubmitStreamRequests() {
+    int maxInFlight = m_MaxBuildsInFlight > 0 ? m_MaxBuildsInFlight : 2 * (int)m_Workers->GetThreadCount();
+    int inFlight;
+    {
+        std::lock_guard<std::mutex> lock(m_BuildQueue->mutex);
+        inFlight = m_BuildQueue->inFlight;
+    }
+    for (const ChunkKey& key : m_StreamOrder) {
+        if (m_StreamStats.requestedThisFrame >= m_MaxRequestsPerFrame || inFlight >= maxInFlight) break;
+        ChunkStreamRequest& request = m_Requests.at(key);
+        if (request.cancelled) continue; // already building or built
+        RequestChunk(key, request);
+        m_StreamStats.requestedThisFrame++;
+        inFlight++;
+    }
+}
+
+void InfiniteTerrain::RequestChunk(const ChunkKey& key, ChunkStreamRequest& request) {
+    request.cancelled = std::make_shared<std::atomic<bool>>(false);
+    // The job only captures values and the shared queue, never `this`
+    std::shared_ptr<ChunkBuildQueue> queue = m_BuildQueue;
+    std::shared_ptr<TerrainTileCache> diskCache = m_DiskCache;
+    std::shared_ptr<std::atomic<bool>> cancelled = request.cancelled;
+    int chunkSize = m_ChunkSize;
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->inFlight++;
+    }
+    m_Workers->Submit([queue, diskCache, cancelled, key, chunkSize]() {
+        // The node may have left the range, or the terrain been destroyed, while this was queued
+        bool skip = cancelled->load(std::memory_order_relaxed);
+        if (!skip) {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            skip = queue->cancelled;
+        }
+        ChunkMeshData mesh;
+        if (!skip) mesh = BuildChunkMesh(key, chunkSize, diskCache.get());
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->inFlight--;
+        if (!skip && !queue->cancelled) {
+            queue->completed.push_back(std::move(mesh));
+        }
+    });
+}
+
+void InfiniteTerrain::CompleteStreamRequest(const ChunkKey& key) {
+    auto it = m_Requests.find(key);
+    if (it == m_Requests.end()) return;
+    // A node re-requested after a cancel can have a second job queued; it is no longer needed
+    if (it->second.cancelled) it->second.cancelled->store(true, std::memory_order_relaxed);
+    float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - it->second.wantedSince).count();
+    m_Requests.erase(it);
     
-    glBindVertexArray(0);
+    m_StreamStats.residentThisFrame++;
+    m_StreamStats.chunksStreamed++;
+    m_StreamStats.lastTimeToVisibleMs = elapsedMs;
+    m_StreamStats.maxTimeToVisibleMs = std::max(m_StreamStats.maxTimeToVisibleMs, elapsedMs);
+    m_TotalTimeToVisibleMs += elapsedMs;
+    m_StreamStats.averageTimeToVisibleMs = (float)(m_TotalTimeToVisibleMs / (double)m_StreamStats.chunksStreamed);
+}
+
+bool InfiniteTerrain::EvictCachedChunk() {
+    ChunkGridCell* victim = nullptr;
+    float victimDistance = -1.0f;
+    for (ChunkGridCell& cell : m_Grid.Cells()) {
+        if (!cell.resident || cell.selected || m_Fallbacks.count(cell.key)) continue;
+        const TerrainChunk& chunk = cell.chunk;
+        glm::vec2 center(chunk.worldPos.x + chunk.size * 0.5f, chunk.worldPos.z + chunk.size * 0.5f);
+        float distance = glm::length(center - glm::vec2(m_CameraPos.x, m_CameraPos.z));
+        if (distance > victimDistance) {
+            victimDistance = distance;
+            victim = &cell;
+        }
+    }
+    if (!victim) {
+        if (!m_PoolFullWarning) {
+            std::cerr << "[InfiniteTerrain] All " << m_ResidentCount << " chunk slots hold selected or drawn nodes; "
+                      << "streaming waits until the view changes (raise the slot count or lower the view distance)" << std::endl;
+            m_PoolFullWarning = true;
+        }
+        return false;
+    }
+    m_PoolFullWarning = false;
+    ReleaseChunk(*victim);
+    return true;
+}
+
+void InfiniteTerrain::UploadReadyChunks() {
+    {
+        std::lock_guard<std::mutex> lock(m_BuildQueue->mutex);
+        for (auto& mesh : m_BuildQueue->completed) {
+            m_ReadyToUpload.push_back(std::move(mesh));
+        }
+        m_BuildQueue->completed.clear();
+    }
+    // The camera may have moved on while a node was being built, or a job from before a mode
+    // switch finished after the node was rebuilt. Upload the rest in streaming order.
+    m_ReadyToUpload.erase(std::remove_if(m_ReadyToUpload.begin(), m_ReadyToUpload.end(), [this](const ChunkMeshData& mesh) {
+        return !m_Requests.count(mesh.key) || m_Grid.IsResident(mesh.key);
+    }), m_ReadyToUpload.end());
+    if (m_ReadyToUpload.empty()) return;
+    std::stable_sort(m_ReadyToUpload.begin(), m_ReadyToUpload.end(), [this](const ChunkMeshData& a, const ChunkMeshData& b) {
+        return m_Requests.at(a.key).priority < m_Requests.at(b.key).priority;
+    });
     
-    return chunk;
+    auto start = std::chrono::steady_clock::now();
+    size_t uploadedBytes = 0;
+    int uploadedCount = 0;
+    size_t consumed = 0;
+    for (; consumed < m_ReadyToUpload.size(); ++consumed) {
+        const ChunkMeshData& mesh = m_ReadyToUpload[consumed];
+        // Two jobs for one node (re-requested after a cancel) can both finish
+        if (m_Grid.IsResident(mesh.key)) continue;
+        size_t meshBytes = mesh.vertices.size() * sizeof(TerrainVertex);
+        if (uploadedCount > 0) {
+            float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (elapsedMs >= m_UploadBudgetMs || uploadedBytes + meshBytes > m_UploadBudgetBytes) break;
+        }
+        TerrainChunk chunk;
+        if (!UploadChunk(mesh, chunk)) {
+            // Pool full: make room from the cache, otherwise retry next frame
+            if (!EvictCachedChunk() || !UploadChunk(mesh, chunk)) break;
+        }
+        SetResident(mesh.key, chunk);
+        CompleteStreamRequest(mesh.key);
+        if (mesh.heightTile) m_HeightTiles->Insert(mesh.key, mesh.heightTile);
+        uploadedBytes += meshBytes;
+        uploadedCount++;
+    }
+    m_ReadyToUpload.erase(m_ReadyToUpload.begin(), m_ReadyToUpload.begin() + consumed);
+}
+
+void InfiniteTerrain::SelectNodes(int camChunkX, int camChunkZ, std::vector<ChunkKey>& out) const {
+    out.clear();
+    // Roots: coarsest-level nodes within the view distance
+    int top = m_LodLevels;
+    int camX = FloorDiv(camChunkX, 1 << top);
+    int camZ = FloorDiv(camChunkZ, 1 << top);
+    for (int z = camZ - m_ViewDistance; z <= camZ + m_ViewDistance; ++z) {
+        for (int x = camX - m_ViewDistance; x <= camX + m_ViewDistance; ++x) {
+            SelectNode(ChunkKey{x, z, top}, camChunkX, camChunkZ, out);
+        }
+    }
+}
+
+void InfiniteTerrain::SelectNode(const ChunkKey& node, int camChunkX, int camChunkZ, std::vector<ChunkKey>& out) const {
+    if (node.level > 0) {
+        // Split when any child falls inside the view distance of the finer level, so every
+        // level keeps at least viewDistance nodes of its own resolution around the camera
+        int childLevel = node.level - 1;
+        int camX = FloorDiv(camChunkX, 1 << childLevel);
+        int camZ = FloorDiv(camChunkZ, 1 << childLevel);
+        int dx = AxisDistance(camX, node.x * 2, node.x * 2 + 1);
+        int dz = AxisDistance(camZ, node.z * 2, node.z * 2 + 1);
+        if (std::max(dx, dz) <= m_ViewDistance) {
+            for (int cz = 0; cz < 2; ++cz) {
+                for (int cx = 0; cx < 2; ++cx) {
+                    SelectNode(ChunkKey{node.x * 2 + cx, node.z * 2 + cz, childLevel}, camChunkX, camChunkZ, out);
+                }
+            }
+            return;
+        }
+    }
+    out.push_back(node);
 }
 
-void InfiniteTerrain::Update(glm::vec3 cameraPos) {
+void InfiniteTerrain::BuildDrawList() {
+    m_DrawList.clear();
+    m_Fallbacks.clear();
+    // A stand-in ancestor overlaps (and z-fights with) anything finer drawn inside it, so every
+    // ancestor of a drawn node is blocked. Inserting stops at the first ancestor already blocked,
+    // since all of its own ancestors are then blocked too.
+    std::unordered_set<ChunkKey, ChunkKeyHash> blocked;
+    auto blockAncestors = [this, &blocked](const ChunkKey& key) {
+        for (int level = key.level + 1; level <= m_LodLevels; ++level) {
+            int scale = 1 << (level - key.level);
+            if (!blocked.insert(ChunkKey{FloorDiv(key.x, scale), FloorDiv(key.z, scale), level}).second) break;
+        }
+    };
+    // Missing selected nodes and their nearest resident ancestor (level -1: none usable)
+    std::vector<std::pair<ChunkKey, ChunkKey>> missing;
+    for (const ChunkKey& key : m_Selected) {
+        if (m_Grid.IsResident(key)) {
+            m_DrawList.push_back(key);
+            blockAncestors(key);
+            continue;
+        }
+        ChunkKey ancestor{0, 0, -1};
+        for (int level = key.level + 1; level <= m_LodLevels; ++level) {
+            int scale = 1 << (level - key.level);
+            ChunkKey parent{FloorDiv(key.x, scale), FloorDiv(key.z, scale), level};
+            if (m_Grid.IsResident(parent)) {
+                ancestor = parent;
+                break;
+            }
+        }
+        missing.push_back({ key, ancestor });
+    }
+    // Of two nested stand-ins the finer one wins
+    for (auto& entry : missing) {
+        if (entry.second.level >= 0 && !blocked.count(entry.second)) blockAncestors(entry.second);
+    }
+    for (auto& entry : missing) {
+        const ChunkKey& key = entry.first;
+        const ChunkKey& ancestor = entry.second;
+        // Not built yet: draw the nearest resident ancestor (camera moved closer) ...
+        if (ancestor.level >= 0 && !blocked.count(ancestor)) {
+            if (m_Fallbacks.insert(ancestor).second) m_DrawList.push_back(ancestor);
+            continue;
+        }
+        // ... or its resident children (camera moved away). Any ancestor containing them is
+        // already blocked, so these never overlap a stand-in drawn above.
+        if (key.level == 0) continue;
+        for (int cz = 0; cz < 2; ++cz) {
+            for (int cx = 0; cx < 2; ++cx) {
+                ChunkKey child{key.x * 2 + cx, key.z * 2 + cz, key.level - 1};
+                if (m_Grid.IsResident(child) && m_Fallbacks.insert(child).second) m_DrawList.push_back(child);
+            }
+        }
+    }
+}
+
+void InfiniteTerrain::Update(glm::vec3 cameraPos, glm::vec3 cameraVelocity) {
+    m_CameraPos = cameraPos;
+    m_CameraVelocity = cameraVelocity;
     int camChunkX = (int)floor(cameraPos.x / m_ChunkSize);
     int camChunkZ = (int)floor(cameraPos.z / m_ChunkSize);
     
-    // Generate chunks around camera
-    for (int z = camChunkZ - m_ViewDistance; z <= camChunkZ + m_ViewDistance; ++z) {
-        for (int x = camChunkX - m_ViewDistance; x <= camChunkX + m_ViewDistance; ++x) {
-            ChunkKey key{x, z};
-            if (m_Chunks.find(key) == m_Chunks.end()) {
-                m_Chunks[key] = GenerateChunk(x, z);
-            }
-        }
+    // Quadtree LOD: full detail around the camera, each ring further out at twice the spacing.
+    // Only recomputed when the camera enters another chunk.
+    glm::ivec2 camChunk(camChunkX, camChunkZ);
+    if (!m_SelectionValid || camChunk != m_SelectionChunk) {
+        std::vector<ChunkKey> selection;
+        SelectNodes(camChunkX, camChunkZ, selection);
+        ApplySelection(selection);
+        m_SelectionChunk = camChunk;
+        m_SelectionValid = true;
     }
     
-    // Remove far chunks to save memory
-    std::vector<ChunkKey> toRemove;
-    for (auto& pair : m_Chunks) {
-        int dx = abs(pair.first.x - camChunkX);
-        int dz = abs(pair.first.z - camChunkZ);
-        if (dx > m_ViewDistance + 2 || dz > m_ViewDistance + 2) {
-            toRemove.push_back(pair.first);
-        }
+    m_StreamStats.requestedThisFrame = 0;
+    m_StreamStats.residentThisFrame = 0;
+    m_StreamStats.cancelledThisFrame = 0;
+    UpdateStreamRequests();
+    
+    if (m_Mode == TerrainMode::GpuHeightmap) {
+        BakeMissingChunks();
+    } else {
+        // Hand the most urgent missing nodes to the worker pool, within the in-flight cap
+        SubmitStreamRequests();
+        
+        // Upload whatever the workers have finished, within this frame's budget.
+        UploadReadyChunks();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_BuildQueue->mutex);
+        m_StreamStats.buildingChunks = m_BuildQueue->inFlight;
+        m_StreamStats.readyChunks = (int)(m_ReadyToUpload.size() + m_BuildQueue->completed.size());
     }
-    for (auto& key : toRemove) {
-        glDeleteVertexArrays(1, &m_Chunks[key].VAO);
-        glDeleteBuffers(1, &m_Chunks[key].VBO);
-        glDeleteBuffers(1, &m_Chunks[key].EBO);
-        m_Chunks.erase(key);
+    m_StreamStats.queuedChunks = 0;
+    for (const auto& pair : m_Requests) {
+        if (!pair.second.cancelled) m_StreamStats.queuedChunks++;
     }
+    // Nodes that are not ready yet are covered by a resident coarser or finer node.
+    // Nodes that left the selection stay cached and are evicted only when a slot is needed.
+    if (m_SelectionChanged || m_ResidentChanged) {
+        BuildDrawList();
+    }
+    m_SelectionChanged = false;
+    m_ResidentChanged = false;
+}
+
+void InfiniteTerrain::ApplySelection(std::vector<ChunkKey>& selection) {
+    for (const ChunkKey& key : m_Selected) {
+        ChunkGridCell& cell = m_Grid.CellFor(key);
+        if (cell.key == key) cell.selected = false;
+    }
+    for (const ChunkKey& key : selection) {
+        ClaimCell(key).selected = true;
+    }
+    m_Selected.swap(selection);
+    m_SelectionChanged = true;
 }
 
-void InfiniteTerrain::Draw(Shader& shader) {
+void InfiniteTerrain::Draw(Shader& shader, const glm::mat4& viewProjection) {
     shader.use();
-    // 绑定贴图到纹理单元0/1/2，并传递给shader
+    DrawUniforms& uniforms = m_DrawUniforms[(int)m_Mode];
+    if (uniforms.program != shader.ID) {
+        uniforms.program = shader.ID;
+        uniforms.fogStart = shader.GetUniform("fogStart");
+        uniforms.fogEnd = shader.GetUniform("fogEnd");
+        uniforms.verticesPerChunk = shader.GetUniform("verticesPerChunk");
+        uniforms.gridSize = shader.GetUniform("gridSize");
+        // Texture units are fixed, so samplers are program state set once
+        shader.setInt("snowTex", 0);
+        shader.setInt("rockTex", 1);
+        shader.setInt("waterTex", 2);
+        shader.setInt("chunkInfo", 3);
+        shader.setInt("heightTiles", 4);
+        shader.setMat4("model", glm::mat4(1.0f));
+    }
+    // 绑定贴图到纹理单元0/1/2
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, m_SnowTex);
-    shader.setInt("snowTex", 0);
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, m_RockTex);
-    shader.setInt("rockTex", 1);
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, m_WaterTex);
-    shader.setInt("waterTex", 2);
-    glm::mat4 model = glm::mat4(1.0f);
-    shader.setMat4("model", model);
-    for (auto& pair : m_Chunks) {
-        glBindVertexArray(pair.second.VAO);
-        glDrawElements(GL_TRIANGLES, pair.second.indexCount, GL_UNSIGNED_INT, 0);
+    // Fog reaches full density where the coarsest ring ends, hiding the terrain edge
+    float visibleRadius = GetVisibleRadius();
+    shader.setFloat(uniforms.fogStart, visibleRadius * 0.3f);
+    shader.setFloat(uniforms.fogEnd, visibleRadius);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_BUFFER, m_ChunkInfoTexture);
+    shader.setInt(uniforms.verticesPerChunk, m_VerticesPerChunk);
+    if (m_Mode == TerrainMode::GpuHeightmap) {
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_HeightTexture);
+        shader.setInt(uniforms.gridSize, m_ChunkSize);
+    }
+    
+    Frustum frustum(viewProjection);
+    m_DrawStats = TerrainDrawStats();
+    m_DrawStats.fallbackChunks = (int)m_Fallbacks.size();
+    // Slots of the visible chunks; draw order follows m_DrawList, so an unchanged view gives an identical list
+    std::vector<int> visibleSlots;
+    visibleSlots.reserve(m_DrawList.size());
+    for (const ChunkKey& key : m_DrawList) {
+        const TerrainChunk& chunk = *m_Grid.Find(key);
+        glm::vec3 boxMin(chunk.worldPos.x, chunk.minHeight, chunk.worldPos.z);
+        glm::vec3 boxMax(chunk.worldPos.x + chunk.size, chunk.maxHeight, chunk.worldPos.z + chunk.size);
+        m_DrawStats.chunksTested++;
+        if (!frustum.IntersectsAABB(boxMin, boxMax)) {
+            m_DrawStats.chunksCulled++;
+            continue;
+        }
+        m_DrawStats.chunksDrawn++;
+        visibleSlots.push_back(chunk.slot);
+    }
+    
+    if (visibleSlots != m_VisibleSlots) {
+        m_VisibleSlots.swap(visibleSlots);
+        size_t drawCount = m_VisibleSlots.size();
+        m_DrawCounts.assign(drawCount, m_IndexCount);
+        m_DrawIndexOffsets.assign(drawCount, nullptr);
+        m_DrawBaseVertices.resize(drawCount);
+        for (size_t i = 0; i < drawCount; ++i) {
+            m_DrawBaseVertices[i] = m_VisibleSlots[i] * m_VerticesPerChunk;
+        }
+        if (m_Mode == TerrainMode::GpuHeightmap) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_InstanceBuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(drawCount * sizeof(int)), m_VisibleSlots.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        m_DrawStats.drawParamsRebuilt = true;
+    }
+    
+    if (!m_VisibleSlots.empty() && m_Mode == TerrainMode::GpuHeightmap) {
+        glBindVertexArray(m_GridVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_SHORT, 0, (GLsizei)m_VisibleSlots.size());
+        glBindVertexArray(0);
+        m_DrawStats.drawCalls = 1;
+    } else if (!m_VisibleSlots.empty()) {
+        glBindVertexArray(m_VAO);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_DrawCounts.data(), GL_UNSIGNED_SHORT,
+                                      m_DrawIndexOffsets.data(), (GLsizei)m_VisibleSlots.size(),
+                                      m_DrawBaseVertices.data());
+        glBindVertexArray(0);
+        m_DrawStats.drawCalls = 1;
     }
-    glBindVertexArray(0);
     // 解绑
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -332,4 +1037,9 @@ void InfiniteTerrain::Draw(Shader& shader) {
     glBindTexture(GL_TEXTURE_2D, 0);
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0);
 }
@@ -1,47 +1,318 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include "HeightTileIndex.h"
 
-// Simple hash for chunk coordinates
-struct ChunkKey {
-    int x, z;
-    bool operator==(const ChunkKey& other) const {
-        return x == other.x && z == other.z;
-    }
+// Packed terrain vertex, 12 bytes (was 9 floats / 36 bytes).
+// x/z are the offset from the chunk origin in world units. The shader finds the origin in a
+// per-slot buffer texture, using gl_VertexID / verticesPerChunk (gl_VertexID includes basevertex).
+// A heightfield normal always points up, so only its x/z are stored (snorm16) and y is
+// rebuilt in the shader. There is no colour: infinite_terrain.frag shades with the rock texture.
+struct TerrainVertex {
+    uint16_t x, z;
+    float height;
+    int16_t nx, nz;
+};
+
+struct TerrainChunk {
+    int slot;               // vertex slot in the terrain's ChunkBufferPool
+    glm::vec3 worldPos;
+    float size;             // world-space edge length (chunkSize << level)
+    float minHeight, maxHeight; // includes the skirt
 };
 
-struct ChunkKeyHash {
-    size_t operator()(const ChunkKey& k) const {
-        return std::hash<int>()(k.x) ^ (std::hash<int>()(k.z) << 16);
+// Nodes around the camera, one toroidal window of side x side cells per LOD level.
+// A node lives in cell (x mod side, z mod side) of its level, so nodes less than `side`
+// apart never share a cell and a lookup is an index computation. A cell keeps its node
+// after it leaves the selection until another node claims the cell.
+struct ChunkGridCell {
+    ChunkKey key{0, 0, -1};
+    TerrainChunk chunk;
+    bool resident = false;
+    bool selected = false;
+};
+
+class ChunkGrid {
+public:
+    // side must be a power of two
+    void Reset(int levels, int side) {
+        m_Side = side;
+        m_Cells.assign((size_t)levels * side * side, ChunkGridCell());
+    }
+    // The cell key maps to; it may hold another node
+    ChunkGridCell& CellFor(const ChunkKey& key) {
+        int mask = m_Side - 1;
+        return m_Cells[((size_t)key.level * m_Side + (key.z & mask)) * m_Side + (key.x & mask)];
+    }
+    const ChunkGridCell& CellFor(const ChunkKey& key) const {
+        return const_cast<ChunkGrid*>(this)->CellFor(key);
     }
+    const TerrainChunk* Find(const ChunkKey& key) const {
+        const ChunkGridCell& cell = CellFor(key);
+        return cell.resident && cell.key == key ? &cell.chunk : nullptr;
+    }
+    bool IsResident(const ChunkKey& key) const { return Find(key) != nullptr; }
+    bool IsSelected(const ChunkKey& key) const {
+        const ChunkGridCell& cell = CellFor(key);
+        return cell.selected && cell.key == key;
+    }
+    std::vector<ChunkGridCell>& Cells() { return m_Cells; }
+private:
+    int m_Side = 0;
+    std::vector<ChunkGridCell> m_Cells;
 };
 
-struct TerrainChunk {
-    unsigned int VAO, VBO, EBO;
-    int indexCount;
-    glm::vec3 worldPos;
+// CPU-side result of meshing one chunk; built on a worker thread, uploaded on the main thread.
+// Every LOD level has the same vertex layout (grid + skirt), so index data is identical
+// for every chunk and lives in one shared buffer.
+struct ChunkMeshData {
+    ChunkKey key;
+    std::vector<TerrainVertex> vertices;
+    float minHeight, maxHeight;
+    std::shared_ptr<const HeightTile> heightTile;
 };
 
+// Per-frame culling counters from InfiniteTerrain::Draw
+struct TerrainDrawStats {
+    int chunksTested = 0;
+    int chunksCulled = 0;
+    int chunksDrawn = 0;
+    int drawCalls = 0;        // 1 whenever anything is visible, independent of view distance
+    bool drawParamsRebuilt = false; // visible set changed since the previous frame
+    int fallbackChunks = 0;   // coarser/finer resident nodes drawn in place of one still building
+};
+
+// Per-frame streaming counters from InfiniteTerrain::Update
+struct TerrainStreamStats {
+    int queuedChunks = 0;       // selected but missing, not handed to a worker yet
+    int buildingChunks = 0;     // submitted to the worker pool, result not back yet
+    int readyChunks = 0;        // built, waiting for upload budget
+    int requestedThisFrame = 0;
+    int residentThisFrame = 0;  // uploaded (CpuMesh) or baked (GpuHeightmap)
+    int cancelledThisFrame = 0; // left the selection before becoming resident
+    // Time from a node first being selected while missing until it is resident
+    float lastTimeToVisibleMs = 0.0f;
+    float averageTimeToVisibleMs = 0.0f;
+    float maxTimeToVisibleMs = 0.0f;
+    uint64_t chunksStreamed = 0;
+};
+
+// A selected node that is not resident yet. The cancel flag is shared with the node's worker
+// job once one is submitted, so a job whose node leaves the range before it starts is skipped.
+struct ChunkStreamRequest {
+    std::chrono::steady_clock::time_point wantedSince;
+    float priority = 0.0f;      // lower streams first
+    std::shared_ptr<std::atomic<bool>> cancelled; // null until submitted
+};
+
+// Finished meshes handed from the workers to the main thread.
+// Shared with in-flight jobs so a job can outlive the terrain that queued it.
+struct ChunkBuildQueue {
+    std::mutex mutex;
+    std::vector<ChunkMeshData> completed;
+    int inFlight = 0;           // submitted jobs that have not finished
+    bool cancelled = false;
+};
+
+// CpuMesh: worker threads mesh each node and the vertices are streamed into a pooled buffer.
+// GpuHeightmap: heights are baked into a layer of a texture array per node and one instanced
+// flat grid is displaced in infinite_terrain_gpu.vert. No vertex uploads. With the IntegerHash
+// noise the GPU bakes the layer itself; the Legacy sin() hash cannot be reproduced on the GPU,
+// so its layers are filled from FbmGrid on the CPU and match the CpuMesh heights exactly.
+enum class TerrainMode { CpuMesh, GpuHeightmap };
+
 class InfiniteTerrain {
 public:
-    InfiniteTerrain(int chunkSize = 64, int viewDistance = 5);
+    // viewDistance: radius in nodes kept at every LOD level around the camera.
+    // lodLevels: number of coarser levels (spacing 2, 4, ... 2^lodLevels) beyond full detail.
+    // workers == nullptr: the terrain starts its own pool
+    InfiniteTerrain(int chunkSize = 64, int viewDistance = 5, int lodLevels = 3, class ThreadPool* workers = nullptr);
     ~InfiniteTerrain();
-    void Update(glm::vec3 cameraPos);
-    void Draw(class Shader& shader);
+    // Missing nodes stream in nearest first, with nodes along cameraVelocity (world units per
+    // second, horizontal part) ahead of those behind the camera
+    void Update(glm::vec3 cameraPos, glm::vec3 cameraVelocity = glm::vec3(0.0f));
+    // Chunks whose bounding box is outside the view frustum are skipped; the rest go out in
+    // one glMultiDrawElementsBaseVertex (CpuMesh) or one instanced draw (GpuHeightmap).
+    // The shader must match the mode: infinite_terrain.vert or infinite_terrain_gpu.vert.
+    // Also sets the fogStart/fogEnd uniforms from the visible radius.
+    void Draw(class Shader& shader, const glm::mat4& viewProjection);
+    // Height queries are served from the finest resident node's HeightTile, falling back to the
+    // noise where no tile is resident (or in GpuHeightmap mode, which keeps heights on the GPU).
+    // Both are safe to call from any thread while the terrain exists.
     float GetHeight(float x, float z) const;
+    void GetHeights(const glm::vec2* positions, float* outHeights, size_t count) const;
+    // Surface normal from the analytic noise derivatives (for slope-dependent effects)
+    glm::vec3 GetNormal(float x, float z) const;
+
+    // Persist generated CpuMesh nodes in a memory-mapped file (see TerrainTileCache). Workers
+    // look nodes up there before evaluating the noise and write new ones back. Call before
+    // the first Update(); the file is capped at maxBytes with LRU replacement.
+    void EnableDiskCache(const std::string& path, size_t maxBytes = 64 * 1024 * 1024);
+    const class TerrainTileCache* GetDiskCache() const { return m_DiskCache.get(); }
+
+    // Switching drops every resident node; the new mode streams in from scratch
+    void SetMode(TerrainMode mode);
+    TerrainMode GetMode() const { return m_Mode; }
+    // GpuHeightmap: node heights baked per Update()
+    void SetBakeBudget(int chunksPerFrame) { m_BakeBudget = chunksPerFrame; }
+
+    // Main-thread GL upload budget per Update(). At least one finished chunk is uploaded
+    // per frame so streaming always makes progress.
+    void SetUploadBudget(float maxMillisPerFrame, size_t maxBytesPerFrame) {
+        m_UploadBudgetMs = maxMillisPerFrame;
+        m_UploadBudgetBytes = maxBytesPerFrame;
+    }
+    // CpuMesh: at most maxRequestsPerFrame nodes are handed to the workers per Update(), and no
+    // more than maxBuildsInFlight are queued or running there at once (0: twice the thread
+    // count), so the pool never holds a backlog that a change of course would make stale.
+    void SetStreamBudget(int maxRequestsPerFrame, int maxBuildsInFlight = 0) {
+        m_MaxRequestsPerFrame = std::max(1, maxRequestsPerFrame);
+        m_MaxBuildsInFlight = maxBuildsInFlight;
+    }
+    // How strongly the flight direction reorders streaming, 0 (distance only) to just below 1.
+    // A node straight ahead is treated as (1 - weight) times its distance, one behind as (1 + weight).
+    void SetStreamHeadingWeight(float weight) { m_StreamHeadingWeight = glm::clamp(weight, 0.0f, 0.95f); }
+    // Distance from the camera that is always covered by terrain (the coarsest ring)
+    float GetVisibleRadius() const { return (float)m_ViewDistance * (float)(m_ChunkSize << m_LodLevels); }
+    size_t GetSelectedChunkCount() const { return m_Selected.size(); }
+    size_t GetResidentChunkCount() const { return (size_t)m_ResidentCount; }
+    size_t GetHeightTileCount() const;
+    // Selected nodes that are not resident yet (queued, building or waiting for upload)
+    size_t GetPendingChunkCount() const { return m_Requests.size(); }
+    const class ChunkBufferPool& GetBufferPool() const { return *m_BufferPool; }
+    const TerrainDrawStats& GetDrawStats() const { return m_DrawStats; }
+    const TerrainStreamStats& GetStreamStats() const { return m_StreamStats; }
 private:
     int m_ChunkSize;
     int m_ViewDistance;
-    std::unordered_map<ChunkKey, TerrainChunk, ChunkKeyHash> m_Chunks;
+    int m_LodLevels;
+    TerrainMode m_Mode = TerrainMode::CpuMesh;
+    // Resident and selected nodes. Nodes that drop out of the selection stay cached until
+    // their slot or their grid cell is needed.
+    ChunkGrid m_Grid;
+    int m_ResidentCount = 0;
+    std::unordered_map<ChunkKey, ChunkStreamRequest, ChunkKeyHash> m_Requests; // selected, not resident
+    std::vector<ChunkKey> m_StreamOrder;                     // missing selected nodes, by priority
+    std::vector<ChunkKey> m_Selected;                        // LOD selection for the current camera
+    std::vector<ChunkKey> m_DrawList;                        // selected nodes, or fallbacks for missing ones
+    std::unordered_set<ChunkKey, ChunkKeyHash> m_Fallbacks;  // resident stand-ins in m_DrawList
+    bool m_PoolFullWarning = false;                          // set while streaming is stalled on slots
+    glm::vec3 m_CameraPos = glm::vec3(0.0f);
+    glm::vec3 m_CameraVelocity = glm::vec3(0.0f);
+    // The selection only depends on the camera's level-0 chunk and is rebuilt when that changes;
+    // the draw list is rebuilt when the selection or the resident set changes
+    glm::ivec2 m_SelectionChunk = glm::ivec2(0);
+    bool m_SelectionValid = false;
+    bool m_SelectionChanged = false;
+    bool m_ResidentChanged = false;
+
+    // Height tiles of resident CPU-mesh nodes; written on the main thread, read from any thread
+    std::unique_ptr<HeightTileIndex> m_HeightTiles;
+
+    std::unique_ptr<class ThreadPool> m_OwnedWorkers;
+    class ThreadPool* m_Workers = nullptr;
+    std::shared_ptr<ChunkBuildQueue> m_BuildQueue;
+    std::shared_ptr<class TerrainTileCache> m_DiskCache;   // shared with in-flight jobs
+    std::vector<ChunkMeshData> m_ReadyToUpload;   // drained from m_BuildQueue, waiting for budget
+
+    // All chunk vertices live in pooled slots of one buffer, drawn through a single VAO
+    // together with the shared 16-bit index buffer
+    std::unique_ptr<class ChunkBufferPool> m_BufferPool;
+    unsigned int m_VAO = 0;
+    unsigned int m_IndexBuffer = 0;
+    int m_IndexCount = 0;
+    int m_VerticesPerChunk = 0;
+    // Per-slot chunk origin (RGBA32F buffer texture), written when a slot is filled
+    unsigned int m_ChunkInfoBuffer = 0;
+    unsigned int m_ChunkInfoTexture = 0;
+    int m_SlotCount = 0;
+
+    // GpuHeightmap resources, created the first time the mode is selected.
+    // Height layers are indexed like pool slots, so chunkInfo serves both modes.
+    unsigned int m_HeightTexture = 0;       // R32F array, (chunkSize + 3)^2 per layer incl. border
+    unsigned int m_BakeFramebuffer = 0;
+    unsigned int m_BakeVAO = 0;             // empty; the bake pass draws a fullscreen triangle
+    unsigned int m_GridVAO = 0;
+    unsigned int m_GridBuffer = 0;
+    unsigned int m_InstanceBuffer = 0;      // visible slots, one per instance
+    std::unique_ptr<class Shader> m_BakeShader;
+    struct BakeUniforms {
+        int nodeOrigin = -1, spacing = -1, noiseSeed = -1;
+    } m_BakeUniforms;
+    std::vector<int> m_FreeLayers;
+    int m_BakeBudget = 32;
+
+    // Multi-draw parameters, rebuilt only when the visible slot list changes
+    std::vector<int> m_VisibleSlots;
+    std::vector<int> m_DrawCounts;
+    std::vector<const void*> m_DrawIndexOffsets;
+    std::vector<int> m_DrawBaseVertices;
+
+    // Handles into the program Draw was given, one per TerrainMode, looked up again only when the
+    // program changes (which also sets its constant uniforms and sampler units)
+    struct DrawUniforms {
+        unsigned int program = 0;
+        int fogStart = -1, fogEnd = -1, verticesPerChunk = -1, gridSize = -1;
+    };
+    DrawUniforms m_DrawUniforms[2];
+
+    TerrainDrawStats m_DrawStats;
+    TerrainStreamStats m_StreamStats;
+    double m_TotalTimeToVisibleMs = 0.0;
+
+    float m_UploadBudgetMs = 2.0f;
+    size_t m_UploadBudgetBytes = 4 * 1024 * 1024;
+    int m_MaxRequestsPerFrame = 8;
+    int m_MaxBuildsInFlight = 0;
+    float m_StreamHeadingWeight = 0.75f;
     
     // Texture IDs
     unsigned int m_SnowTex = 0;
     unsigned int m_RockTex = 0;
     unsigned int m_WaterTex = 0;
     
-    TerrainChunk GenerateChunk(int chunkX, int chunkZ);
-    float Noise(float x, float z) const;
-    glm::vec3 GetTerrainColor(float height) const;
+    // CPU stage: pure function of its arguments, safe to run on any thread
+    static ChunkMeshData BuildChunkMesh(const ChunkKey& key, int chunkSize, class TerrainTileCache* diskCache);
+    static std::vector<uint16_t> BuildChunkIndices(int chunkSize);
+    static float SkirtDepth(int level);
+    // GL stage: main thread only. Returns false when no pool slot is free.
+    bool UploadChunk(const ChunkMeshData& mesh, TerrainChunk& chunk);
+    void ReleaseChunk(ChunkGridCell& cell);
+    // Makes cell.key == key, releasing a different node that still occupies the cell
+    ChunkGridCell& ClaimCell(const ChunkKey& key);
+    void SetResident(const ChunkKey& key, const TerrainChunk& chunk);
+    void ApplySelection(std::vector<ChunkKey>& selection);
+    void InitRenderData();
+    void InitGpuRenderData();
+    void BakeMissingChunks();
+    void WriteChunkInfo(const TerrainChunk& chunk, int level);
+    // Drops requests for nodes that left the selection, adds newly missing ones and orders
+    // m_StreamOrder by StreamPriority
+    void UpdateStreamRequests();
+    float StreamPriority(const ChunkKey& key) const;
+    void SubmitStreamRequests();
+    void RequestChunk(const ChunkKey& key, ChunkStreamRequest& request);
+    // Erases the node's request and records its time-to-visible
+    void CompleteStreamRequest(const ChunkKey& key);
+    void UploadReadyChunks();
+    // Frees the cached (unselected, not drawn) node furthest from the camera. Fails, and says
+    // so once per stall, when every slot holds a selected or drawn node.
+    bool EvictCachedChunk();
+
+    // Quadtree LOD selection around the camera's level-0 chunk
+    void SelectNodes(int camChunkX, int camChunkZ, std::vector<ChunkKey>& out) const;
+    void SelectNode(const ChunkKey& node, int camChunkX, int camChunkZ, std::vector<ChunkKey>& out) const;
+    void BuildDrawList();
+
+    static glm::vec3 NormalFromSlope(float dHdx, float dHdz);
     void LoadTerrainTextures();
 };
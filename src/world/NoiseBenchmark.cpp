@@ -0,0 +1,63 @@
+#include "NoiseBenchmark.h"
+#include "TerrainNoise.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Keeps results alive so the timed loops are not optimised away
+static volatile float s_Sink;
+
+static double NanosecondsPerSample(std::chrono::steady_clock::duration elapsed, size_t samples) {
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (double)samples;
+}
+
+void RunNoiseBenchmark() {
+    using namespace TerrainNoise;
+    using Clock = std::chrono::steady_clock;
+    const NoiseBackend previousBackend = GetBackend();
+    const uint32_t previousSeed = GetSeed();
+    const NoiseBackend backends[] = { NoiseBackend::Legacy, NoiseBackend::IntegerHash };
+    const int pointSamples = 1000000;
+    const int tileSide = 33;       // one terrain node
+    const int tileCount = 2000;
+
+    std::printf("Noise benchmark (%s kernels)\n", GetSimdLevelName(GetSimdLevel()));
+    std::printf("%-12s %14s %14s %14s\n", "backend", "Fbm ns", "tile ns", "far tile ns");
+    double baseline[3] = { 0.0, 0.0, 0.0 };
+    for (NoiseBackend backend : backends) {
+        SetBackend(backend, 1337);
+
+        // Single points scattered along a flight path
+        Clock::time_point start = Clock::now();
+        float sum = 0.0f;
+        for (int i = 0; i < pointSamples; ++i) {
+            sum += Fbm(i * 0.37f, i * 0.11f);
+        }
+        double pointNs = NanosecondsPerSample(Clock::now() - start, pointSamples);
+
+        // Node-sized tiles with derivatives, as the terrain workers build them.
+        // "far" starts a million units out, where the legacy hash sees huge lattice indices.
+        std::vector<float> heights(tileSide * tileSide), dx(heights.size()), dz(heights.size());
+        double tileNs[2];
+        for (int far = 0; far < 2; ++far) {
+            float origin = far ? 1.0e6f : 0.0f;
+            start = Clock::now();
+            for (int t = 0; t < tileCount; ++t) {
+                FbmGridDerivatives(origin + (t % 45) * 32.0f, origin + (t / 45) * 32.0f, (float)(1 << (t % 4)),
+                                   tileSide, tileSide, heights.data(), dx.data(), dz.data());
+                sum += heights[t % heights.size()];
+            }
+            tileNs[far] = NanosecondsPerSample(Clock::now() - start, (size_t)tileCount * heights.size());
+        }
+        s_Sink = sum;
+
+        if (backend == NoiseBackend::Legacy) {
+            baseline[0] = pointNs;
+            baseline[1] = tileNs[0];
+            baseline[2] = tileNs[1];
+        }
+        std::printf("%-12s %8.1f (%3.1fx) %8.1f (%3.1fx) %8.1f (%3.1fx)\n", GetBackendName(backend),
+                    pointNs, baseline[0] / pointNs, tileNs[0], baseline[1] / tileNs[0], tileNs[1], baseline[2] / tileNs[1]);
+    }
+    SetBackend(previousBackend, previousSeed);
+}
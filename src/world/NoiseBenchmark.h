@@ -0,0 +1,6 @@
+#pragma once
+
+// Microbenchmark of the terrain noise backends (run with `Skyscape --bench-noise`).
+// Prints ns per sample for single-point Fbm and for node-sized FbmGridDerivatives tiles,
+// for every backend at the best SIMD level.
+void RunNoiseBenchmark();
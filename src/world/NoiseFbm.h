@@ -0,0 +1,160 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+// Compile-time specialised fBm value noise.
+//
+// Fbm<Hash, Params>() takes the octave count, lacunarity, gain and base frequency from Params
+// as constants and expands one term per octave through a fold expression, so there is no loop
+// and every octave's frequency and amplitude is a literal.
+//
+// Hash policies supply the lattice values in [-1, 1):
+//   LegacyHash   the original fract(sin(n) * 43758.5453); ignores the seed and loses precision
+//                once sin() is fed large lattice indices far from the origin
+//   IntegerHash  PCG integer hash of (ix, iz, octave, seed); exact at any lattice index
+// A hash splits into MakeRow (per lattice row) and Value (per lattice point) so tile
+// evaluation can hash a row once.
+namespace TerrainNoise {
+
+// Shape of the terrain fBm
+struct TerrainFbmParams {
+    static constexpr int Octaves = 6;
+    static constexpr float BaseFrequency = 0.005f;
+    static constexpr float Lacunarity = 2.0f;
+    static constexpr float Gain = 0.5f;
+    static constexpr float HeightScale = 100.0f;
+    static constexpr float HeightOffset = -10.0f;
+};
+
+constexpr float ConstPow(float base, int exponent) {
+    float result = 1.0f;
+    for (int i = 0; i < exponent; ++i) result *= base;
+    return result;
+}
+
+template <class Params>
+constexpr float OctaveFrequency(int octave) { return Params::BaseFrequency * ConstPow(Params::Lacunarity, octave); }
+
+template <class Params>
+constexpr float OctaveAmplitude(int octave) { return ConstPow(Params::Gain, octave); }
+
+template <class Params>
+constexpr float AmplitudeSum() {
+    float sum = 0.0f;
+    for (int i = 0; i < Params::Octaves; ++i) sum += OctaveAmplitude<Params>(i);
+    return sum;
+}
+
+struct LegacyHash {
+    typedef int Row;
+    static Row MakeRow(int iz, int /*octave*/, uint32_t /*seed*/) { return iz; }
+    static float Value(int ix, Row iz) {
+        // 基础伪随机hash
+        float n = (float)(ix * 49632 + iz * 325176);
+        return std::fmod(std::sin(n) * 43758.5453f, 1.0f);
+    }
+};
+
+struct IntegerHash {
+    typedef uint32_t Row;
+    // PCG output permutation as a hash (Jarzynski & Olano, "Hash Functions for GPU Rendering")
+    static uint32_t Pcg(uint32_t v) {
+        uint32_t state = v * 747796405u + 2891336453u;
+        uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+    static Row MakeRow(int iz, int octave, uint32_t seed) {
+        return Pcg((uint32_t)iz + Pcg(seed + (uint32_t)octave * 0x9E3779B9u));
+    }
+    static float Value(int ix, Row row) {
+        // Top 24 bits -> [-1, 1), exactly representable
+        return (float)(Pcg((uint32_t)ix + row) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+    }
+};
+
+// 2D value noise at lattice coordinates (x, z)
+template <class Hash>
+inline float ValueNoise(float x, float z, int octave, uint32_t seed) {
+    int ix = (int)std::floor(x);
+    int iz = (int)std::floor(z);
+    float fx = x - ix;
+    float fz = z - iz;
+    typename Hash::Row row0 = Hash::MakeRow(iz, octave, seed);
+    typename Hash::Row row1 = Hash::MakeRow(iz + 1, octave, seed);
+    float v00 = Hash::Value(ix, row0);
+    float v10 = Hash::Value(ix + 1, row0);
+    float v01 = Hash::Value(ix, row1);
+    float v11 = Hash::Value(ix + 1, row1);
+    float u = fx * fx * (3.0f - 2.0f * fx);
+    float v = fz * fz * (3.0f - 2.0f * fz);
+    float a = v00 * (1-u) + v10 * u;
+    float b = v01 * (1-u) + v11 * u;
+    return a * (1-v) + b * v;
+}
+
+// Value noise and its analytic partial derivatives (with respect to lattice coordinates)
+template <class Hash>
+inline float ValueNoiseDerivatives(float x, float z, int octave, uint32_t seed, float* dndx, float* dndz) {
+    int ix = (int)std::floor(x);
+    int iz = (int)std::floor(z);
+    float fx = x - ix;
+    float fz = z - iz;
+    typename Hash::Row row0 = Hash::MakeRow(iz, octave, seed);
+    typename Hash::Row row1 = Hash::MakeRow(iz + 1, octave, seed);
+    float v00 = Hash::Value(ix, row0);
+    float v10 = Hash::Value(ix + 1, row0);
+    float v01 = Hash::Value(ix, row1);
+    float v11 = Hash::Value(ix + 1, row1);
+    float u = fx * fx * (3.0f - 2.0f * fx);
+    float v = fz * fz * (3.0f - 2.0f * fz);
+    float du = 6.0f * fx * (1.0f - fx);
+    float dv = 6.0f * fz * (1.0f - fz);
+    float a = v00 * (1-u) + v10 * u;
+    float b = v01 * (1-u) + v11 * u;
+    *dndx = ((v10 - v00) * (1-v) + (v11 - v01) * v) * du;
+    *dndz = (b - a) * dv;
+    return a * (1-v) + b * v;
+}
+
+namespace Detail {
+
+template <class Hash, class Params, int... Octave>
+inline float FbmUnrolled(float x, float z, uint32_t seed, std::integer_sequence<int, Octave...>) {
+    float sum = 0.0f;
+    ((sum += ValueNoise<Hash>(x * OctaveFrequency<Params>(Octave), z * OctaveFrequency<Params>(Octave), Octave, seed)
+             * OctaveAmplitude<Params>(Octave)), ...);
+    return sum / AmplitudeSum<Params>() * Params::HeightScale + Params::HeightOffset;
+}
+
+template <class Hash, class Params, int... Octave>
+inline float FbmDerivativesUnrolled(float x, float z, uint32_t seed, float* dHdx, float* dHdz,
+                                    std::integer_sequence<int, Octave...>) {
+    float sum = 0.0f, sumDx = 0.0f, sumDz = 0.0f;
+    auto octaveTerm = [&](int octave, float frequency, float amplitude) {
+        float dndx, dndz;
+        sum += ValueNoiseDerivatives<Hash>(x * frequency, z * frequency, octave, seed, &dndx, &dndz) * amplitude;
+        // 链式法则：d/dx noise(x * f) = f * noise'
+        sumDx += dndx * (amplitude * frequency);
+        sumDz += dndz * (amplitude * frequency);
+    };
+    (octaveTerm(Octave, OctaveFrequency<Params>(Octave), OctaveAmplitude<Params>(Octave)), ...);
+    *dHdx = sumDx / AmplitudeSum<Params>() * Params::HeightScale;
+    *dHdz = sumDz / AmplitudeSum<Params>() * Params::HeightScale;
+    return sum / AmplitudeSum<Params>() * Params::HeightScale + Params::HeightOffset;
+}
+
+}
+
+template <class Hash, class Params = TerrainFbmParams>
+inline float Fbm(float x, float z, uint32_t seed) {
+    return Detail::FbmUnrolled<Hash, Params>(x, z, seed, std::make_integer_sequence<int, Params::Octaves>());
+}
+
+template <class Hash, class Params = TerrainFbmParams>
+inline float FbmDerivatives(float x, float z, uint32_t seed, float* dHdx, float* dHdz) {
+    return Detail::FbmDerivativesUnrolled<Hash, Params>(x, z, seed, dHdx, dHdz,
+                                                        std::make_integer_sequence<int, Params::Octaves>());
+}
+
+}
@@ -0,0 +1,188 @@
+#include "ParticleDepthSort.h"
+#include "../core/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+namespace {
+
+// Particles per block; blocks are the unit of parallel work
+const int BlockSize = 16384;
+
+void ForEachBlock(ThreadPool* workers, int blockCount, const std::function<void(int)>& body) {
+    if (workers && blockCount > 1) {
+        workers->ParallelFor(blockCount, body);
+        return;
+    }
+    for (int b = 0; b < blockCount; ++b) body(b);
+}
+
+}
+
+const std::vector<uint32_t>& ParticleDepthSort::Sort(const float* x, const float* y, const float* z, int count,
+                                                      const glm::vec4& viewDepthRow, ThreadPool* workers) {
+    auto start = std::chrono::high_resolution_clock::now();
+    m_Stats.count = count;
+    m_Stats.radixPasses = 0;
+    if (count <= 0) {
+        m_Order.clear();
+        m_Position.clear();
+        m_Stats.incremental = false;
+        m_Stats.milliseconds = 0.0;
+        return m_Order;
+    }
+
+    ComputeKeys(x, y, z, count, viewDepthRow, workers);
+    m_Stats.incremental = RepairPreviousOrder(count);
+    if (!m_Stats.incremental) {
+        RadixSort(count, workers);
+    }
+    m_Position.resize(count);
+    for (int i = 0; i < count; ++i) {
+        m_Position[m_Order[i]] = (uint32_t)i;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_Stats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    return m_Order;
+}
+
+void ParticleDepthSort::ComputeKeys(const float* x, const float* y, const float* z, int count,
+                                    const glm::vec4& viewDepthRow, ThreadPool* workers) {
+    m_Depth.resize(count);
+    m_Keys.resize(count);
+    int blockCount = (count + BlockSize - 1) / BlockSize;
+    std::vector<float> blockMin(blockCount), blockMax(blockCount);
+
+    ForEachBlock(workers, blockCount, [&](int b) {
+        int begin = b * BlockSize;
+        int end = std::min(count, begin + BlockSize);
+        float lo = 3.4e38f, hi = -3.4e38f;
+        for (int i = begin; i < end; ++i) {
+            float d = viewDepthRow.x * x[i] + viewDepthRow.y * y[i] + viewDepthRow.z * z[i] + viewDepthRow.w;
+            m_Depth[i] = d;
+            lo = std::min(lo, d);
+            hi = std::max(hi, d);
+        }
+        blockMin[b] = lo;
+        blockMax[b] = hi;
+    });
+
+    float lo = *std::min_element(blockMin.begin(), blockMin.end());
+    float hi = *std::max_element(blockMax.begin(), blockMax.end());
+    // View space looks down -z, so ascending z is farthest first
+    float scale = (hi > lo) ? 65535.0f / (hi - lo) : 0.0f;
+    ForEachBlock(workers, blockCount, [&](int b) {
+        int begin = b * BlockSize;
+        int end = std::min(count, begin + BlockSize);
+        for (int i = begin; i < end; ++i) {
+            m_Keys[i] = (uint16_t)((m_Depth[i] - lo) * scale);
+        }
+    });
+}
+
+void ParticleDepthSort::SwapRemove(int index, int last) {
+    // Slots past the last Sort's count hold particles that are not in the order yet
+    int sorted = (int)m_Position.size();
+    if (index >= sorted) return;
+    if (m_Position[index] != Removed) m_Order[m_Position[index]] = Removed;
+    m_Position[index] = Removed;
+    if (last != index && last < sorted && m_Position[last] != Removed) {
+        m_Order[m_Position[last]] = (uint32_t)index;
+        m_Position[index] = m_Position[last];
+        m_Position[last] = Removed;
+    }
+}
+
+bool ParticleDepthSort::RepairPreviousOrder(int count) {
+    // Entries of removed particles are dropped; particles added since the last Sort go last
+    m_Present.assign(count, 0);
+    m_OrderScratch.clear();
+    m_OrderScratch.reserve(count);
+    for (uint32_t index : m_Order) {
+        if (index < (uint32_t)count) {
+            m_OrderScratch.push_back(index);
+            m_Present[index] = 1;
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        if (!m_Present[i]) m_OrderScratch.push_back((uint32_t)i);
+    }
+    m_Order.swap(m_OrderScratch);
+
+    m_SortKeys.resize(count);
+    int descents = 0;
+    for (int i = 0; i < count; ++i) {
+        m_SortKeys[i] = m_Keys[m_Order[i]];
+        if (i > 0 && m_SortKeys[i] < m_SortKeys[i - 1]) descents++;
+    }
+    if (descents == 0) return true;
+    if (descents > count / 32 + 8) return false;
+
+    // Insertion sort costs one step per inversion; give up past a linear budget
+    long long budget = 8LL * count;
+    for (int i = 1; i < count; ++i) {
+        uint16_t key = m_SortKeys[i];
+        if (key >= m_SortKeys[i - 1]) continue;
+        uint32_t index = m_Order[i];
+        int j = i;
+        while (j > 0 && m_SortKeys[j - 1] > key && budget > 0) {
+            m_SortKeys[j] = m_SortKeys[j - 1];
+            m_Order[j] = m_Order[j - 1];
+            --j;
+            --budget;
+        }
+        m_SortKeys[j] = key;
+        m_Order[j] = index;
+        if (budget <= 0) return false;
+    }
+    return true;
+}
+
+void ParticleDepthSort::RadixSort(int count, ThreadPool* workers) {
+    int blockCount = (count + BlockSize - 1) / BlockSize;
+    m_Histograms.resize((size_t)blockCount * 256);
+    m_SortKeysScratch.resize(count);
+    m_OrderScratch.resize(count);
+
+    for (int shift = 0; shift < 16; shift += 8) {
+        ForEachBlock(workers, blockCount, [&](int b) {
+            uint32_t* histogram = &m_Histograms[(size_t)b * 256];
+            std::fill(histogram, histogram + 256, 0u);
+            int end = std::min(count, (b + 1) * BlockSize);
+            for (int i = b * BlockSize; i < end; ++i) {
+                histogram[(m_SortKeys[i] >> shift) & 0xFF]++;
+            }
+        });
+
+        // Exclusive prefix in (digit, block) order keeps the scatter stable
+        uint32_t offset = 0;
+        bool trivial = false;
+        for (int digit = 0; digit < 256; ++digit) {
+            uint32_t digitTotal = 0;
+            for (int b = 0; b < blockCount; ++b) {
+                uint32_t& entry = m_Histograms[(size_t)b * 256 + digit];
+                uint32_t n = entry;
+                entry = offset;
+                offset += n;
+                digitTotal += n;
+            }
+            if (digitTotal == (uint32_t)count) trivial = true;
+        }
+        if (trivial) continue;   // every key has the same digit here
+
+        ForEachBlock(workers, blockCount, [&](int b) {
+            uint32_t* next = &m_Histograms[(size_t)b * 256];
+            int end = std::min(count, (b + 1) * BlockSize);
+            for (int i = b * BlockSize; i < end; ++i) {
+                uint16_t key = m_SortKeys[i];
+                uint32_t dst = next[(key >> shift) & 0xFF]++;
+                m_SortKeysScratch[dst] = key;
+                m_OrderScratch[dst] = m_Order[i];
+            }
+        });
+        m_SortKeys.swap(m_SortKeysScratch);
+        m_Order.swap(m_OrderScratch);
+        m_Stats.radixPasses++;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Back-to-front draw order for alpha-blended particles. View depth is quantized to 16-bit keys
+// and (key, index) pairs are sorted with a two-pass LSD radix sort; histograms and scatters run
+// on fixed blocks split across a ThreadPool, so the sort is linear in the particle count and
+// its result does not depend on the thread count.
+// Particles move little between frames, so Sort first re-keys last frame's order: if it is still
+// nearly sorted a bounded insertion sort repairs it, and only otherwise is the radix sort run.
+// The owner reports each swap-remove through SwapRemove, so that order keeps following the
+// surviving particles rather than the slot numbers.
+class ParticleDepthSort {
+public:
+    struct Stats {
+        int count = 0;
+        double milliseconds = 0.0;   // last Sort
+        bool incremental = false;    // last Sort repaired the previous order instead of radix sorting
+        int radixPasses = 0;         // last Sort; passes over a digit every key shares are skipped
+    };
+
+    // Orders particles [0, count) farthest first. viewDepthRow is the view matrix row giving view
+    // space z: z = dot(viewDepthRow.xyz, position) + viewDepthRow.w. Returns the particle indices.
+    const std::vector<uint32_t>& Sort(const float* x, const float* y, const float* z, int count,
+                                      const glm::vec4& viewDepthRow, ThreadPool* workers = nullptr);
+
+    // The particle at index was removed and the one at last moved into its slot (last == index
+    // when the removed particle was the last one). O(1).
+    void SwapRemove(int index, int last);
+
+    const std::vector<uint32_t>& GetOrder() const { return m_Order; }
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    void ComputeKeys(const float* x, const float* y, const float* z, int count,
+                     const glm::vec4& viewDepthRow, ThreadPool* workers);
+    // Carries last frame's order over to [0, count); true if it can be repaired cheaply
+    bool RepairPreviousOrder(int count);
+    void RadixSort(int count, ThreadPool* workers);
+
+    std::vector<uint32_t> m_Order, m_OrderScratch;
+    // Inverse of m_Order from the last Sort, updated by SwapRemove; Removed marks no entry
+    static const uint32_t Removed = 0xFFFFFFFFu;
+    std::vector<uint32_t> m_Position;
+    std::vector<uint16_t> m_Keys;             // per particle
+    std::vector<uint16_t> m_SortKeys, m_SortKeysScratch;   // per position in m_Order
+    std::vector<float> m_Depth;
+    std::vector<uint32_t> m_Histograms;       // 256 per block
+    std::vector<uint8_t> m_Present;
+    Stats m_Stats;
+};
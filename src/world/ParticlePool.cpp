@@ -0,0 +1,53 @@
+#include "ParticlePool.h"
+#include "ParticleDepthSort.h"
+#include <algorithm>
+
+ParticlePool::ParticlePool(int capacity)
+    : posX(capacity), posY(capacity), posZ(capacity),
+      velX(capacity), velY(capacity), velZ(capacity),
+      life(capacity), size(capacity), m_Capacity(capacity)
+{
+}
+
+int ParticlePool::Claim(bool& recycled) {
+    recycled = false;
+    if (m_AliveCount < m_Capacity) {
+        return m_AliveCount++;
+    }
+    if (m_Overflow == ParticleOverflow::DropNew || m_Capacity == 0) {
+        return -1;
+    }
+    // Every particle is alive: recycle them in turn
+    int idx = m_NextRecycled;
+    m_NextRecycled = (m_NextRecycled + 1) % m_Capacity;
+    recycled = true;
+    return idx;
+}
+
+int ParticlePool::Append(int count, int& appended) {
+    int first = m_AliveCount;
+    appended = count > 0 ? std::min(count, m_Capacity - m_AliveCount) : 0;
+    m_AliveCount += appended;
+    return first;
+}
+
+void ParticlePool::RemoveDead(ParticleDepthSort* sort) {
+    int i = 0;
+    while (i < m_AliveCount) {
+        if (life[i] > 0.0f) {
+            ++i;
+            continue;
+        }
+        // Swap-remove: the last live particle fills the hole and is checked next
+        int last = --m_AliveCount;
+        posX[i] = posX[last];
+        posY[i] = posY[last];
+        posZ[i] = posZ[last];
+        velX[i] = velX[last];
+        velY[i] = velY[last];
+        velZ[i] = velZ[last];
+        life[i] = life[last];
+        size[i] = size[last];
+        if (sort) sort->SwapRemove(i, last);
+    }
+}
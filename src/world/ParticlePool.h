@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+
+class ParticleDepthSort;
+
+// What emission does once every particle slot is alive
+enum class ParticleOverflow {
+    Recycle,   // overwrite live particles in turn, so new ones always appear
+    DropNew    // discard the new particles
+};
+
+// Cpu particle state: one array per field (structure of arrays), kept dense: indices
+// [0, aliveCount) are live, and a particle that dies is replaced by the last live one.
+// Holds no GL objects, so the slot policy can be exercised without a context.
+class ParticlePool {
+public:
+    explicit ParticlePool(int capacity = 0);
+
+    // Slot for one new particle, or -1 when the pool is full and the policy drops it. recycled
+    // is set when a live particle is overwritten. The caller fills in every field
+    int Claim(bool& recycled);
+    // Up to count slots right past the live range, starting at the returned index; appended
+    // receives how many. Never touches live particles
+    int Append(int count, int& appended);
+    // Removes particles whose life ran out, swapping the last live one into each hole; sort
+    // (may be null) is told about every move
+    void RemoveDead(ParticleDepthSort* sort);
+
+    int GetCapacity() const { return m_Capacity; }
+    int GetAliveCount() const { return m_AliveCount; }
+    void SetOverflowPolicy(ParticleOverflow policy) { m_Overflow = policy; }
+    ParticleOverflow GetOverflowPolicy() const { return m_Overflow; }
+
+    // One entry per slot
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> velX, velY, velZ;
+    std::vector<float> life;   // remaining life in seconds
+    std::vector<float> size;   // size at emission; negative marks a splash
+
+private:
+    int m_Capacity;
+    int m_AliveCount = 0;
+    // Slot overwritten next when every particle is alive. Kept across RemoveDead and only
+    // wrapped at the capacity, so a pool that stays full cycles through every slot rather than
+    // overwriting the particles it recycled last frame
+    int m_NextRecycled = 0;
+    ParticleOverflow m_Overflow = ParticleOverflow::Recycle;
+};
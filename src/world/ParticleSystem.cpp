@@ -1,172 +1,674 @@
 #include "ParticleSystem.h"
+#include "../core/CpuFeatures.h"
+#include "../core/ThreadPool.h"
+#include "../graphics/SceneDepthCopy.h"
+#include "../graphics/Shader.h"
+#include "InfiniteTerrain.h"
+#include "NoiseFbm.h"
+#include "TerrainNoise.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <memory>
 
-ParticleSystem::ParticleSystem(ParticleType type, int maxParticles)
-    : m_Type(type), m_MaxParticles(maxParticles), m_LastUsedParticle(0)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PARTICLE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(PARTICLE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PARTICLE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PARTICLE_TARGET(isa)
+#endif
+
+namespace {
+
+// --- Integration kernels ---
+
+// Per particle, in the order the original AoS update used:
+// life -= dt; velocity += gravity * dt; position += velocity * dt;
+// then, for snow, velocity.xz += (sin(life * 3), cos(life * 2.5)) * sway * dt
+struct ParticleArrays {
+    float* posX; float* posY; float* posZ;
+    float* velX; float* velY; float* velZ;
+    float* life;
+};
+
+struct IntegrateParams {
+    float dt;
+    float gravityX, gravityY, gravityZ;
+    float sway;   // 0 disables the snow drift
+};
+
+typedef void (*IntegrateKernel)(const ParticleArrays& a, const IntegrateParams& p, int begin, int end);
+
+const float TwoPi = 6.28318531f;
+const float InvTwoPi = 0.159154943f;
+const float HalfPi = 1.57079633f;
+
+// Parabolic sine approximation (error below 0.001), shared by every kernel so they agree
+inline float FastSin(float x) {
+    x -= TwoPi * std::nearbyint(x * InvTwoPi);
+    float y = 1.27323954f * x - 0.405284735f * x * std::fabs(x);
+    return 0.225f * (y * std::fabs(y) - y) + y;
+}
+
+void IntegrateScalar(const ParticleArrays& a, const IntegrateParams& p, int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+        a.life[i] -= p.dt;
+        a.velX[i] += p.gravityX * p.dt;
+        a.velY[i] += p.gravityY * p.dt;
+        a.velZ[i] += p.gravityZ * p.dt;
+        a.posX[i] += a.velX[i] * p.dt;
+        a.posY[i] += a.velY[i] * p.dt;
+        a.posZ[i] += a.velZ[i] * p.dt;
+        if (p.sway != 0.0f) {
+            a.velX[i] += FastSin(a.life[i] * 3.0f) * p.sway * p.dt;
+            a.velZ[i] += FastSin(a.life[i] * 2.5f + HalfPi) * p.sway * p.dt;
+        }
+    }
+}
+
+#ifdef PARTICLE_X86
+PARTICLE_TARGET("sse2")
+inline __m128 FastSinSSE2(__m128 x) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(InvTwoPi))));
+    x = _mm_sub_ps(x, _mm_mul_ps(turns, _mm_set1_ps(TwoPi)));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(1.27323954f), x),
+                          _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.405284735f), x), _mm_andnot_ps(signMask, x)));
+    __m128 yAbs = _mm_andnot_ps(signMask, y);
+    return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.225f), _mm_sub_ps(_mm_mul_ps(y, yAbs), y)), y);
+}
+
+PARTICLE_TARGET("sse2")
+void IntegrateSSE2(const ParticleArrays& a, const IntegrateParams& p, int begin, int end) {
+    const __m128 dt = _mm_set1_ps(p.dt);
+    const __m128 dvx = _mm_set1_ps(p.gravityX * p.dt);
+    const __m128 dvy = _mm_set1_ps(p.gravityY * p.dt);
+    const __m128 dvz = _mm_set1_ps(p.gravityZ * p.dt);
+    const __m128 swayDt = _mm_set1_ps(p.sway * p.dt);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(a.life + i), dt);
+        __m128 vx = _mm_add_ps(_mm_loadu_ps(a.velX + i), dvx);
+        __m128 vy = _mm_add_ps(_mm_loadu_ps(a.velY + i), dvy);
+        __m128 vz = _mm_add_ps(_mm_loadu_ps(a.velZ + i), dvz);
+        _mm_storeu_ps(a.posX + i, _mm_add_ps(_mm_loadu_ps(a.posX + i), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(a.posY + i, _mm_add_ps(_mm_loadu_ps(a.posY + i), _mm_mul_ps(vy, dt)));
+        _mm_storeu_ps(a.posZ + i, _mm_add_ps(_mm_loadu_ps(a.posZ + i), _mm_mul_ps(vz, dt)));
+        if (p.sway != 0.0f) {
+            __m128 sx = FastSinSSE2(_mm_mul_ps(life, _mm_set1_ps(3.0f)));
+            __m128 sz = FastSinSSE2(_mm_add_ps(_mm_mul_ps(life, _mm_set1_ps(2.5f)), _mm_set1_ps(HalfPi)));
+            vx = _mm_add_ps(vx, _mm_mul_ps(sx, swayDt));
+            vz = _mm_add_ps(vz, _mm_mul_ps(sz, swayDt));
+        }
+        _mm_storeu_ps(a.life + i, life);
+        _mm_storeu_ps(a.velX + i, vx);
+        _mm_storeu_ps(a.velY + i, vy);
+        _mm_storeu_ps(a.velZ + i, vz);
+    }
+    IntegrateScalar(a, p, i, end);
+}
+
+PARTICLE_TARGET("avx2")
+inline __m256 FastSinAVX2(__m256 x) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 turns = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(InvTwoPi)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm256_sub_ps(x, _mm256_mul_ps(turns, _mm256_set1_ps(TwoPi)));
+    __m256 y = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(1.27323954f), x),
+                             _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.405284735f), x), _mm256_andnot_ps(signMask, x)));
+    __m256 yAbs = _mm256_andnot_ps(signMask, y);
+    return _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(0.225f), _mm256_sub_ps(_mm256_mul_ps(y, yAbs), y)), y);
+}
+
+PARTICLE_TARGET("avx2")
+void IntegrateAVX2(const ParticleArrays& a, const IntegrateParams& p, int begin, int end) {
+    const __m256 dt = _mm256_set1_ps(p.dt);
+    const __m256 dvx = _mm256_set1_ps(p.gravityX * p.dt);
+    const __m256 dvy = _mm256_set1_ps(p.gravityY * p.dt);
+    const __m256 dvz = _mm256_set1_ps(p.gravityZ * p.dt);
+    const __m256 swayDt = _mm256_set1_ps(p.sway * p.dt);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(a.life + i), dt);
+        __m256 vx = _mm256_add_ps(_mm256_loadu_ps(a.velX + i), dvx);
+        __m256 vy = _mm256_add_ps(_mm256_loadu_ps(a.velY + i), dvy);
+        __m256 vz = _mm256_add_ps(_mm256_loadu_ps(a.velZ + i), dvz);
+        _mm256_storeu_ps(a.posX + i, _mm256_add_ps(_mm256_loadu_ps(a.posX + i), _mm256_mul_ps(vx, dt)));
+        _mm256_storeu_ps(a.posY + i, _mm256_add_ps(_mm256_loadu_ps(a.posY + i), _mm256_mul_ps(vy, dt)));
+        _mm256_storeu_ps(a.posZ + i, _mm256_add_ps(_mm256_loadu_ps(a.posZ + i), _mm256_mul_ps(vz, dt)));
+        if (p.sway != 0.0f) {
+            __m256 sx = FastSinAVX2(_mm256_mul_ps(life, _mm256_set1_ps(3.0f)));
+            __m256 sz = FastSinAVX2(_mm256_add_ps(_mm256_mul_ps(life, _mm256_set1_ps(2.5f)), _mm256_set1_ps(HalfPi)));
+            vx = _mm256_add_ps(vx, _mm256_mul_ps(sx, swayDt));
+            vz = _mm256_add_ps(vz, _mm256_mul_ps(sz, swayDt));
+        }
+        _mm256_storeu_ps(a.life + i, life);
+        _mm256_storeu_ps(a.velX + i, vx);
+        _mm256_storeu_ps(a.velY + i, vy);
+        _mm256_storeu_ps(a.velZ + i, vz);
+    }
+    IntegrateScalar(a, p, i, end);
+}
+#endif
+
+IntegrateKernel SelectIntegrateKernel() {
+    const CpuFeatures& cpu = CpuFeatures::Get();
+#ifdef PARTICLE_X86
+    if (cpu.avx2) return IntegrateAVX2;
+    if (cpu.sse2) return IntegrateSSE2;
+#endif
+    (void)cpu;
+    return IntegrateScalar;
+}
+
+// Look of each particle type over its life
+struct ParticleStyle {
+    float alphaScale;   // alpha = remaining life fraction * alphaScale
+    float sizeGrowth;   // size grows by this fraction of the emitted size over the particle's life
+    float sway;         // horizontal drift amplitude (snow)
+};
+
+ParticleStyle StyleFor(ParticleType type) {
+    switch (type) {
+        // Trail expands and fades gradually
+        case ParticleType::Trail: return { 0.5f, 0.8f, 0.0f };
+        case ParticleType::Snow: return { 0.6f, 0.0f, 0.5f };
+        default: return { 0.6f, 0.0f, 0.0f };
+    }
+}
+
+// Shortest splash life accepted; WriteVertices divides by it
+const float MinSplashLife = 0.001f;
+
+// Each system draws from its own PCG stream so two emitters never repeat each other
+uint64_t NextRandomStream() {
+    static std::atomic<uint64_t> stream{ 1 };
+    return stream.fetch_add(1);
+}
+
+}
+
+ParticleSystem::ParticleSystem(ParticleType type, int maxParticles, ThreadPool* workers, ParticleSimulation simulation)
+    : m_Type(type), m_Simulation(simulation), m_MaxParticles(maxParticles),
+      m_Random(0x853c49e6748fea9bULL, NextRandomStream()), m_Workers(workers)
 {
-    m_Particles.resize(maxParticles);
+    SetType(type);
     
-    // Set default properties based on type
+    if (m_Simulation == ParticleSimulation::GpuTransformFeedback) {
+        InitGpuSimulation();
+        return;
+    }
+    m_Pool = ParticlePool(maxParticles);
+    m_Vertices.resize(maxParticles);
+    InitRenderData();
+}
+
+void ParticleSystem::SetType(ParticleType type) {
+    m_Type = type;
+    // Default properties of the type
     switch (type) {
         case ParticleType::Trail:
             m_EmissionRate = 20.0f;
             m_ParticleLife = 5.0f;
             m_ParticleSize = 15.0f;
             m_Gravity = glm::vec3(0.0f, -0.3f, 0.0f);
+            // Softer blue-gray color like real contrails
+            m_Color = glm::vec4(0.85f, 0.9f, 0.95f, 0.5f);
             break;
         case ParticleType::Rain:
             m_EmissionRate = 200.0f;
             m_ParticleLife = 5.0f;
             m_ParticleSize = 2.0f;
             m_Gravity = glm::vec3(0.0f, -20.0f, 0.0f);
+            m_Color = glm::vec4(0.7f, 0.8f, 1.0f, 0.6f);
             break;
         case ParticleType::Snow:
             m_EmissionRate = 100.0f;
             m_ParticleLife = 8.0f;
             m_ParticleSize = 4.0f;
             m_Gravity = glm::vec3(0.0f, -2.0f, 0.0f);
+            m_Color = glm::vec4(1.0f, 1.0f, 1.0f, 0.9f);
             break;
     }
-    
-    InitRenderData();
+}
+
+void ParticleSystem::SetSplashLife(float seconds) {
+    m_SplashLife = std::max(seconds, MinSplashLife);
 }
 
 ParticleSystem::~ParticleSystem() {
     glDeleteVertexArrays(1, &m_VAO);
-    glDeleteBuffers(1, &m_VBO);
+    glDeleteVertexArrays(2, m_GpuVAOs);
+    glDeleteBuffers(2, m_GpuBuffers);
 }
 
 void ParticleSystem::InitRenderData() {
-    // Setup VAO/VBO for instanced rendering
+    // Each frame's vertices land in the next ring region; the attributes point at the start of
+    // the buffer and Draw selects the region through the first vertex
+    m_Stream = std::make_unique<StreamingBuffer>((size_t)m_MaxParticles * sizeof(ParticleVertex));
     glGenVertexArrays(1, &m_VAO);
-    glGenBuffers(1, &m_VBO);
     
     glBindVertexArray(m_VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, m_MaxParticles * sizeof(Particle), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, m_Stream->GetBuffer());
     
     // Position
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, position));
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, position));
     
     // Color
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, color));
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, color));
     
     // Size
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, size));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, size));
     
     glBindVertexArray(0);
 }
 
-int ParticleSystem::FindUnusedParticle() {
-    // Search from last used particle
-    for (int i = m_LastUsedParticle; i < m_MaxParticles; i++) {
-        if (m_Particles[i].life <= 0.0f) {
-            m_LastUsedParticle = i;
-            return i;
-        }
+void ParticleSystem::SetDepthSort(bool enabled) {
+    if (m_Simulation != ParticleSimulation::Cpu || enabled == (m_Sort != nullptr)) return;
+    if (!enabled) {
+        m_Sort.reset();
+        m_IndexStream.reset();
+        return;
     }
-    
-    // Search from beginning
-    for (int i = 0; i < m_LastUsedParticle; i++) {
-        if (m_Particles[i].life <= 0.0f) {
-            m_LastUsedParticle = i;
-            return i;
+    m_Sort = std::make_unique<ParticleDepthSort>();
+    m_IndexStream = std::make_unique<StreamingBuffer>((size_t)m_MaxParticles * sizeof(uint32_t));
+    // The element binding is VAO state
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexStream->GetBuffer());
+    glBindVertexArray(0);
+}
+
+void ParticleSystem::InitGpuSimulation() {
+    m_GpuUpdateShader = std::make_unique<Shader>("assets/shaders/particle_update.vert",
+                                                 std::vector<const char*>{ "outPositionLife", "outVelocitySize" });
+    m_GpuDrawShader = std::make_unique<Shader>("assets/shaders/particle_gpu.vert", "assets/shaders/particle.frag");
+    m_GpuUpdateShader->OnFinish([this] { SetupGpuUpdateProgram(); });
+    m_GpuDrawShader->OnFinish([this] { SetupGpuDrawProgram(); });
+
+    // Zeroed state: every slot starts dead (life 0)
+    std::vector<float> zeros((size_t)m_MaxParticles * 8, 0.0f);
+    glGenBuffers(2, m_GpuBuffers);
+    glGenVertexArrays(2, m_GpuVAOs);
+    for (int i = 0; i < 2; ++i) {
+        glBindVertexArray(m_GpuVAOs[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, m_GpuBuffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, zeros.size() * sizeof(float), zeros.data(), GL_DYNAMIC_COPY);
+        // Position + life
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        // Velocity + size
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(4 * sizeof(float)));
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    std::cout << "[ParticleSystem] GPU simulation: " << m_MaxParticles << " slots" << std::endl;
+}
+
+void ParticleSystem::WriteVertices(int begin, int end) {
+    ParticleStyle style = StyleFor(m_Type);
+    uint8_t r = (uint8_t)(m_Color.r * 255.0f + 0.5f);
+    uint8_t g = (uint8_t)(m_Color.g * 255.0f + 0.5f);
+    uint8_t b = (uint8_t)(m_Color.b * 255.0f + 0.5f);
+    float invLife = 1.0f / m_ParticleLife;
+    float invSplashLife = 1.0f / m_SplashLife;
+    for (int i = begin; i < end; ++i) {
+        float size = m_Pool.size[i];
+        float lifeRatio;
+        if (size >= 0.0f) {
+            lifeRatio = std::max(0.0f, m_Pool.life[i] * invLife);
+        } else {
+            // Splashes fade over their own short life
+            lifeRatio = std::max(0.0f, m_Pool.life[i] * invSplashLife);
+            size = -size;
         }
+        ParticleVertex& vertex = m_Vertices[i];
+        vertex.position = glm::vec3(m_Pool.posX[i], m_Pool.posY[i], m_Pool.posZ[i]);
+        vertex.color[0] = r;
+        vertex.color[1] = g;
+        vertex.color[2] = b;
+        // Fade out
+        vertex.color[3] = (uint8_t)(std::min(1.0f, lifeRatio * style.alphaScale) * 255.0f + 0.5f);
+        vertex.size = size * (1.0f + (1.0f - lifeRatio) * style.sizeGrowth);
     }
+}
     
-    m_LastUsedParticle = 0;
-    return 0;
+int ParticleSystem::ClaimSlot() {
+    bool recycled;
+    int idx = m_Pool.Claim(recycled);
+    if (idx < 0) {
+        ++m_EmitStats.dropped;
+        return -1;
+    }
+    ++m_EmitStats.emitted;
+    if (recycled) ++m_EmitStats.recycled;
+    return idx;
 }
 
 void ParticleSystem::Emit(const glm::vec3& position, const glm::vec3& direction, int count) {
+    if (m_Simulation == ParticleSimulation::GpuTransformFeedback) {
+        EmitVolume({ position, glm::vec3(0.0f) }, direction, count);
+        return;
+    }
+    m_EmitStats.requested += std::max(0, count);
+    // Random spread (larger for trail)
+    float spread = (m_Type == ParticleType::Trail) ? 0.5f : 0.1f;
     for (int i = 0; i < count; i++) {
-        int idx = FindUnusedParticle();
+        int idx = ClaimSlot();
+        if (idx < 0) {
+            m_EmitStats.dropped += count - i - 1;
+            return;
+        }
+        m_Pool.posX[idx] = position.x;
+        m_Pool.posY[idx] = position.y;
+        m_Pool.posZ[idx] = position.z;
+        m_Pool.velX[idx] = direction.x + m_Random.NextFloat11() * spread;
+        m_Pool.velY[idx] = direction.y + m_Random.NextFloat11() * spread;
+        m_Pool.velZ[idx] = direction.z + m_Random.NextFloat11() * spread;
+        m_Pool.life[idx] = m_ParticleLife;
+        m_Pool.size[idx] = m_ParticleSize;
+        WriteVertices(idx, idx + 1);
+    }
+}
         
-        // Random spread (larger for trail)
-        float spreadFactor = (m_Type == ParticleType::Trail) ? 100.0f : 500.0f;
-        float spreadX = ((rand() % 100) - 50) / spreadFactor;
-        float spreadY = ((rand() % 100) - 50) / spreadFactor;
-        float spreadZ = ((rand() % 100) - 50) / spreadFactor;
+void ParticleSystem::EmitVolume(const ParticleBox& box, const glm::vec3& velocity, int count) {
+    if (count <= 0) return;
+    m_EmitStats.requested += count;
+    if (m_Simulation == ParticleSimulation::GpuTransformFeedback) {
+        if ((int)m_GpuEmitters.size() >= MaxGpuEmitters) {
+            if (!m_GpuEmitterWarning) {
+                std::cerr << "[ParticleSystem] More than " << MaxGpuEmitters << " emitters in one frame; extra emission dropped" << std::endl;
+                m_GpuEmitterWarning = true;
+            }
+            m_EmitStats.dropped += count;
+            return;
+        }
+        // One frame's emission window spans at most every slot once
+        int pending = 0;
+        for (const GpuEmitter& emitter : m_GpuEmitters) pending += emitter.count;
+        int accepted = std::min(count, m_MaxParticles - pending);
+        m_EmitStats.dropped += count - accepted;
+        if (accepted > 0) m_GpuEmitters.push_back({ box.center, box.halfExtent, velocity, accepted });
+        return;
+    }
         
-        m_Particles[idx].position = position;
-        m_Particles[idx].velocity = direction + glm::vec3(spreadX, spreadY, spreadZ);
-        m_Particles[idx].life = m_ParticleLife;
-        m_Particles[idx].size = m_ParticleSize;
+    glm::vec3 lo = box.center - box.halfExtent;
+    glm::vec3 size = box.halfExtent * 2.0f;
+    // Same random spread as Emit and the GPU spawn
+    float spread = (m_Type == ParticleType::Trail) ? 0.5f : 0.1f;
+    // Free slots are one contiguous run past the live range, filled in a single pass
+    int appended;
+    int first = m_Pool.Append(count, appended);
+    for (int idx = first; idx < first + appended; idx++) {
+        m_Pool.posX[idx] = lo.x + size.x * m_Random.NextFloat01();
+        m_Pool.posY[idx] = lo.y + size.y * m_Random.NextFloat01();
+        m_Pool.posZ[idx] = lo.z + size.z * m_Random.NextFloat01();
+        m_Pool.velX[idx] = velocity.x + m_Random.NextFloat11() * spread;
+        m_Pool.velY[idx] = velocity.y + m_Random.NextFloat11() * spread;
+        m_Pool.velZ[idx] = velocity.z + m_Random.NextFloat11() * spread;
+        m_Pool.life[idx] = m_ParticleLife;
+        m_Pool.size[idx] = m_ParticleSize;
+    }
+    m_EmitStats.emitted += appended;
+    WriteVertices(first, first + appended);
         
-        // Set color based on type
-        switch (m_Type) {
-            case ParticleType::Trail:
-                // Softer blue-gray color like real contrails
-                m_Particles[idx].color = glm::vec4(0.85f, 0.9f, 0.95f, 0.5f);
-                break;
-            case ParticleType::Rain:
-                m_Particles[idx].color = glm::vec4(0.7f, 0.8f, 1.0f, 0.6f);
-                break;
-            case ParticleType::Snow:
-                m_Particles[idx].color = glm::vec4(1.0f, 1.0f, 1.0f, 0.9f);
-                break;
+    // Whatever did not fit goes through the overflow policy
+    for (int i = appended; i < count; i++) {
+        int idx = ClaimSlot();
+        if (idx < 0) {
+            m_EmitStats.dropped += count - i - 1;
+            return;
         }
+        m_Pool.posX[idx] = lo.x + size.x * m_Random.NextFloat01();
+        m_Pool.posY[idx] = lo.y + size.y * m_Random.NextFloat01();
+        m_Pool.posZ[idx] = lo.z + size.z * m_Random.NextFloat01();
+        m_Pool.velX[idx] = velocity.x + m_Random.NextFloat11() * spread;
+        m_Pool.velY[idx] = velocity.y + m_Random.NextFloat11() * spread;
+        m_Pool.velZ[idx] = velocity.z + m_Random.NextFloat11() * spread;
+        m_Pool.life[idx] = m_ParticleLife;
+        m_Pool.size[idx] = m_ParticleSize;
+        WriteVertices(idx, idx + 1);
     }
 }
 
-void ParticleSystem::Update(float deltaTime) {
-    for (auto& particle : m_Particles) {
-        if (particle.life > 0.0f) {
-            particle.life -= deltaTime;
-            particle.velocity += m_Gravity * deltaTime;
-            particle.position += particle.velocity * deltaTime;
-            
-            // Fade out
-            float lifeRatio = particle.life / m_ParticleLife;
-            if (m_Type == ParticleType::Trail) {
-                // Trail expands and fades gradually
-                particle.color.a = lifeRatio * 0.5f;
-                particle.size = m_ParticleSize * (1.0f + (1.0f - lifeRatio) * 0.8f);
-            } else {
-                particle.color.a = lifeRatio * 0.6f;
+void ParticleSystem::EmitVolumeOverTime(const ParticleBox& box, const glm::vec3& velocity, float deltaTime) {
+    float owed = m_EmissionCarry + m_EmissionRate * deltaTime;
+    int count = (int)owed;
+    m_EmissionCarry = owed - (float)count;
+    EmitVolume(box, velocity, count);
+}
+
+void ParticleSystem::UpdateRange(int begin, int end, float deltaTime) {
+    static const IntegrateKernel integrate = SelectIntegrateKernel();
+    ParticleArrays arrays = { m_Pool.posX.data(), m_Pool.posY.data(), m_Pool.posZ.data(),
+                              m_Pool.velX.data(), m_Pool.velY.data(), m_Pool.velZ.data(), m_Pool.life.data() };
+    IntegrateParams params = { deltaTime, m_Gravity.x, m_Gravity.y, m_Gravity.z, StyleFor(m_Type).sway };
+    integrate(arrays, params, begin, end);
+    if (m_Collision != ParticleCollision::None && m_CollisionTerrain) {
+        CollideRange(begin, end);
+    }
+    WriteVertices(begin, end);
+}
+
+void ParticleSystem::CollideRange(int begin, int end) {
+    // Heights are looked up in batches, and only for particles below the highest possible ground
+    const int batchSize = 256;
+    glm::vec2 positions[batchSize];
+    float heights[batchSize];
+    int indices[batchSize];
+    int i = begin;
+    while (i < end) {
+        int n = 0;
+        for (; i < end && n < batchSize; ++i) {
+            if (m_Pool.life[i] > 0.0f && m_Pool.posY[i] < TerrainNoise::MaxHeight) {
+                positions[n] = glm::vec2(m_Pool.posX[i], m_Pool.posZ[i]);
+                indices[n++] = i;
             }
-            
-            // Add some randomness for snow
-            if (m_Type == ParticleType::Snow) {
-                particle.velocity.x += sin(particle.life * 3.0f) * 0.5f * deltaTime;
-                particle.velocity.z += cos(particle.life * 2.5f) * 0.5f * deltaTime;
+        }
+        if (n == 0) continue;
+        m_CollisionTerrain->GetHeights(positions, heights, (size_t)n);
+        for (int k = 0; k < n; ++k) {
+            int p = indices[k];
+            if (m_Pool.posY[p] >= heights[k]) continue;
+            // Splashes that land again are removed
+            if (m_Collision == ParticleCollision::Kill || m_Pool.size[p] < 0.0f) {
+                m_Pool.life[p] = 0.0f;
+                continue;
             }
+            // Stateless hash of the slot, so safe in parallel ranges
+            uint32_t key = (uint32_t)p ^ m_SplashSeed;
+            m_Pool.posY[p] = heights[k];
+            m_Pool.velX[p] = m_Pool.velX[p] * 0.2f + TerrainNoise::IntegerHash::Value(0, key) * 1.5f;
+            m_Pool.velY[p] = 3.0f;
+            m_Pool.velZ[p] = m_Pool.velZ[p] * 0.2f + TerrainNoise::IntegerHash::Value(1, key) * 1.5f;
+            m_Pool.life[p] = m_SplashLife;
+            m_Pool.size[p] = -0.75f * m_Pool.size[p];
         }
     }
 }
 
-void ParticleSystem::Draw(unsigned int shaderProgram) {
-    // Enable blending for transparency
+void ParticleSystem::SetupGpuUpdateProgram() {
+    Shader& update = *m_GpuUpdateShader;
+    GpuUpdateUniforms& u = m_GpuUpdateUniforms;
+    u.deltaTime = update.GetUniform("deltaTime");
+    u.gravity = update.GetUniform("gravity");
+    u.lifetime = update.GetUniform("lifetime");
+    u.particleSize = update.GetUniform("particleSize");
+    u.sway = update.GetUniform("sway");
+    u.spread = update.GetUniform("spread");
+    u.emitStart = update.GetUniform("emitStart");
+    u.emitterCount = update.GetUniform("emitterCount");
+    u.seed = update.GetUniform("seed");
+    u.emitEnd = update.GetUniform("emitEnd");
+    u.emitCenter = update.GetUniform("emitCenter");
+    u.emitHalfExtent = update.GetUniform("emitHalfExtent");
+    u.emitVelocity = update.GetUniform("emitVelocity");
+    u.collisionMode = update.GetUniform("collisionMode");
+    u.collisionViewProjection = update.GetUniform("collisionViewProjection");
+    u.nearPlane = update.GetUniform("nearPlane");
+    u.farPlane = update.GetUniform("farPlane");
+    u.splashLife = update.GetUniform("splashLife");
+    // The pool size never changes
+    update.setInt("capacity", m_MaxParticles);
+    update.setInt("sceneDepth", 0);
+}
+
+void ParticleSystem::SetupGpuDrawProgram() {
+    Shader& draw = *m_GpuDrawShader;
+    m_GpuDrawUniforms.particleColor = draw.GetUniform("particleColor");
+    m_GpuDrawUniforms.lifetime = draw.GetUniform("lifetime");
+    m_GpuDrawUniforms.splashLife = draw.GetUniform("splashLife");
+    m_GpuDrawUniforms.alphaScale = draw.GetUniform("alphaScale");
+    m_GpuDrawUniforms.sizeGrowth = draw.GetUniform("sizeGrowth");
+}
+
+void ParticleSystem::UpdateGpu(float deltaTime) {
+    // Emission requests become consecutive ranges of the ring window starting at m_GpuEmitStart
+    int emitEnd[MaxGpuEmitters];
+    glm::vec3 centers[MaxGpuEmitters], halfExtents[MaxGpuEmitters], velocities[MaxGpuEmitters];
+    int emitterCount = (int)m_GpuEmitters.size();
+    int total = 0;
+    for (int i = 0; i < emitterCount; ++i) {
+        const GpuEmitter& emitter = m_GpuEmitters[i];
+        total = std::min(m_MaxParticles, total + emitter.count);
+        emitEnd[i] = total;
+        centers[i] = emitter.center;
+        halfExtents[i] = emitter.halfExtent;
+        velocities[i] = emitter.velocity;
+    }
+    m_GpuEmitters.clear();
+
+    Shader& shader = *m_GpuUpdateShader;
+    const GpuUpdateUniforms& u = m_GpuUpdateUniforms;
+    shader.use();
+    shader.setFloat(u.deltaTime, deltaTime);
+    shader.setVec3(u.gravity, m_Gravity);
+    shader.setFloat(u.lifetime, m_ParticleLife);
+    shader.setFloat(u.particleSize, m_ParticleSize);
+    shader.setFloat(u.sway, StyleFor(m_Type).sway);
+    // Same range as Emit's random spread
+    shader.setFloat(u.spread, (m_Type == ParticleType::Trail) ? 0.5f : 0.1f);
+    shader.setInt(u.emitStart, m_GpuEmitStart);
+    shader.setInt(u.emitterCount, emitterCount);
+    shader.setInt(u.seed, (int)(++m_GpuFrame * 0x9E3779B9u));
+    bool collide = m_Collision != ParticleCollision::None && m_CollisionDepth && m_CollisionDepth->IsValid();
+    shader.setInt(u.collisionMode, collide ? (int)m_Collision : 0);
+    if (collide) {
+        shader.setMat4(u.collisionViewProjection, m_CollisionDepth->GetViewProjection());
+        shader.setFloat(u.nearPlane, m_CollisionDepth->GetNearPlane());
+        shader.setFloat(u.farPlane, m_CollisionDepth->GetFarPlane());
+        shader.setFloat(u.splashLife, m_SplashLife);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_CollisionDepth->GetTexture());
+    }
+    if (emitterCount > 0) {
+        shader.setIntArray(u.emitEnd, emitEnd, emitterCount);
+        shader.setVec3Array(u.emitCenter, centers, emitterCount);
+        shader.setVec3Array(u.emitHalfExtent, halfExtents, emitterCount);
+        shader.setVec3Array(u.emitVelocity, velocities, emitterCount);
+    }
+
+    int next = 1 - m_GpuCurrent;
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(m_GpuVAOs[m_GpuCurrent]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_GpuBuffers[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, m_MaxParticles);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    if (collide) glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_GpuCurrent = next;
+    m_GpuEmitStart = (m_GpuEmitStart + total) % m_MaxParticles;
+}
+
+void ParticleSystem::Update(float deltaTime) {
+    if (m_Simulation == ParticleSimulation::GpuTransformFeedback) {
+        UpdateGpu(deltaTime);
+        return;
+    }
+    m_Pool.RemoveDead(m_Sort.get());
+    m_SplashSeed = m_Random.NextU32();
+    int count = m_Pool.GetAliveCount();
+    if (count == 0) return;
+    if (!m_Workers || count < m_ParallelThreshold) {
+        UpdateRange(0, count, deltaTime);
+        return;
+    }
+
+    const int rangeSize = 8192;
+    m_Workers->ParallelFor((count + rangeSize - 1) / rangeSize, [this, count, rangeSize, deltaTime](int range) {
+        UpdateRange(range * rangeSize, std::min(count, (range + 1) * rangeSize), deltaTime);
+    });
+}
+
+void ParticleSystem::DrawGpu() {
+    ParticleStyle style = StyleFor(m_Type);
+    Shader& shader = *m_GpuDrawShader;
+    shader.use();
+    shader.setFloat(m_GpuDrawUniforms.alphaScale, style.alphaScale);
+    shader.setFloat(m_GpuDrawUniforms.sizeGrowth, style.sizeGrowth);
+    shader.setVec4(m_GpuDrawUniforms.particleColor, m_Color);
+    shader.setFloat(m_GpuDrawUniforms.lifetime, m_ParticleLife);
+    shader.setFloat(m_GpuDrawUniforms.splashLife, m_SplashLife);
+
+    glBindVertexArray(m_GpuVAOs[m_GpuCurrent]);
+    glDrawArrays(GL_POINTS, 0, m_MaxParticles);
+    glBindVertexArray(0);
+}
+
+void ParticleSystem::Draw(unsigned int shaderProgram, const glm::mat4& view) {
+    if (m_Simulation == ParticleSimulation::Cpu && m_Pool.GetAliveCount() == 0) return;
+
+    // Enable blending for transparency; alpha accumulates coverage so an offscreen target
+    // (LowResParticlePass) ends up holding premultiplied colour
     glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
     glDepthMask(GL_FALSE);
     
     // Enable point sprites
     glEnable(GL_PROGRAM_POINT_SIZE);
     
-    // Update VBO
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_Particles.size() * sizeof(Particle), m_Particles.data());
-    
-    // Draw
-    glUseProgram(shaderProgram);
-    glBindVertexArray(m_VAO);
-    
-    int aliveCount = 0;
-    for (const auto& p : m_Particles) {
-        if (p.life > 0.0f) aliveCount++;
-    }
-    
-    if (aliveCount > 0) {
-        glDrawArrays(GL_POINTS, 0, m_Particles.size());
+    if (m_Simulation == ParticleSimulation::GpuTransformFeedback) {
+        DrawGpu();
+    } else {
+        // Stream the live particles only
+        int aliveCount = m_Pool.GetAliveCount();
+        long long offset = m_Stream->Write(m_Vertices.data(), (size_t)aliveCount * sizeof(ParticleVertex),
+                                           sizeof(ParticleVertex));
+        GLint firstVertex = (GLint)(offset / (long long)sizeof(ParticleVertex));
+        if (offset >= 0 && m_Sort) {
+            // View-space z row of the view matrix (glm is column-major)
+            glm::vec4 depthRow(view[0][2], view[1][2], view[2][2], view[3][2]);
+            const std::vector<uint32_t>& order = m_Sort->Sort(m_Pool.posX.data(), m_Pool.posY.data(), m_Pool.posZ.data(),
+                                                              aliveCount, depthRow, m_Workers);
+            long long indexOffset = m_IndexStream->Write(order.data(), order.size() * sizeof(uint32_t), sizeof(uint32_t));
+            if (indexOffset >= 0) {
+                glUseProgram(shaderProgram);
+                glBindVertexArray(m_VAO);
+                glDrawElementsBaseVertex(GL_POINTS, aliveCount, GL_UNSIGNED_INT, (void*)(intptr_t)indexOffset, firstVertex);
+                glBindVertexArray(0);
+            }
+            m_IndexStream->EndFrame();
+        } else if (offset >= 0) {
+            glUseProgram(shaderProgram);
+            glBindVertexArray(m_VAO);
+            glDrawArrays(GL_POINTS, firstVertex, aliveCount);
+            glBindVertexArray(0);
+        }
+        m_Stream->EndFrame();
     }
     
-    glBindVertexArray(0);
-    
     // Restore state
     glDepthMask(GL_TRUE);
     glDisable(GL_BLEND);
@@ -1,13 +1,18 @@
 #pragma once
+#include "../core/Random.h"
+#include "../graphics/StreamingBuffer.h"
+#include "ParticleDepthSort.h"
+#include "ParticlePool.h"
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
-struct Particle {
+// What the GPU reads per live particle, 20 bytes
+struct ParticleVertex {
     glm::vec3 position;
-    glm::vec3 velocity;
-    glm::vec4 color;
-    float life;      // Remaining life in seconds
+    uint8_t color[4];   // RGBA8, normalized in the shader input
     float size;
 };
 
@@ -17,35 +22,171 @@ enum class ParticleType {
     Snow      // Snowflakes
 };
 
+// Axis-aligned emission volume: center +- halfExtent
+struct ParticleBox {
+    glm::vec3 center;
+    glm::vec3 halfExtent;
+};
+
+// What happens to a particle that reaches the ground
+enum class ParticleCollision {
+    None,     // falls through until its life runs out
+    Kill,     // removed on impact
+    Splash    // becomes a short-lived splash hopping off the surface, then is removed
+};
+
+// Totals since construction, so callers can tell whether the pool is sized right
+struct ParticleEmitStats {
+    uint64_t requested = 0;  // particles asked for through Emit/EmitVolume
+    uint64_t emitted = 0;    // Cpu mode: particles placed in a slot. The GPU spawns only into the
+                             // dead slots of its emission window and never reports how many
+    uint64_t recycled = 0;   // of those, how many replaced a live particle
+    uint64_t dropped = 0;    // particles discarded (DropNew overflow, over MaxGpuEmitters or
+                             // beyond one frame's GPU emission window)
+};
+
+// Cpu: particles live in a ParticlePool, one array per field kept dense over the live range.
+// Update runs a SIMD kernel over that range, split across a ThreadPool when one is given and
+// enough particles are alive. Draw streams only the live particles' ParticleVertex through a
+// fenced ring buffer, so it never waits for the GPU to release last frame's vertices.
+// GpuTransformFeedback: particle state lives in two GPU buffers and each Update advances it from
+// one into the other with transform feedback (particle_update.vert). Emission requests are
+// passed as uniforms and the GPU spawns them into dead slots; the CPU touches no particle data.
+enum class ParticleSimulation { Cpu, GpuTransformFeedback };
+
 class ParticleSystem {
 public:
-    ParticleSystem(ParticleType type, int maxParticles = 1000);
+    // At most this many Emit/EmitVolume calls per frame are honoured in GpuTransformFeedback mode
+    static const int MaxGpuEmitters = 8;
+
+    // workers == nullptr: Update runs on the calling thread (Cpu mode only)
+    ParticleSystem(ParticleType type, int maxParticles = 1000, class ThreadPool* workers = nullptr,
+                   ParticleSimulation simulation = ParticleSimulation::Cpu);
     ~ParticleSystem();
 
+    // Resets emission rate, life, size, gravity and colour to the type's defaults and switches the
+    // look and snow sway; live particles carry on under the new type. Only uniforms change in
+    // GpuTransformFeedback mode
+    void SetType(ParticleType type);
     void Update(float deltaTime);
     void Emit(const glm::vec3& position, const glm::vec3& direction, int count = 1);
-    void Draw(unsigned int shaderProgram);
+    // count particles at uniformly random positions in box, all with the same velocity.
+    // Cost is constant per particle: slots are appended to the live range or taken per the
+    // overflow policy, never searched for
+    void EmitVolume(const ParticleBox& box, const glm::vec3& velocity, int count);
+    // EmitVolume at the emission rate for deltaTime seconds; fractions carry over to the next call
+    void EmitVolumeOverTime(const ParticleBox& box, const glm::vec3& velocity, float deltaTime);
+    // shaderProgram is particle.vert + particle.frag; GpuTransformFeedback draws with its own
+    // program (particle_gpu.vert) instead. Both take the camera from FrameData's follow view;
+    // view is that same matrix, which depth sorting orders the particles by
+    void Draw(unsigned int shaderProgram, const glm::mat4& view);
     
     void SetEmissionRate(float particlesPerSecond) { m_EmissionRate = particlesPerSecond; }
     void SetParticleLife(float life) { m_ParticleLife = life; }
     void SetParticleSize(float size) { m_ParticleSize = size; }
     void SetGravity(const glm::vec3& gravity) { m_Gravity = gravity; }
+    // Cpu mode only. GpuTransformFeedback never replaces live particles: it respawns the dead
+    // slots of its emission window, so emission beyond the free slots there is lost
+    void SetOverflowPolicy(ParticleOverflow policy) { m_Pool.SetOverflowPolicy(policy); }
+    // Updates with fewer live particles than this stay on the calling thread
+    void SetParallelThreshold(int particles) { m_ParallelThreshold = particles; }
+    // Ground collision. Cpu mode tests against the terrain heightfield, GpuTransformFeedback
+    // against a scene depth copy (from the previous frame when captured after Update); a
+    // collision mode without its ground source does nothing
+    void SetCollision(ParticleCollision mode) { m_Collision = mode; }
+    void SetCollisionTerrain(const class InfiniteTerrain* terrain) { m_CollisionTerrain = terrain; }
+    void SetCollisionDepth(const class SceneDepthCopy* sceneDepth) { m_CollisionDepth = sceneDepth; }
+    // Clamped to at least a millisecond
+    void SetSplashLife(float seconds);
+    // Cpu mode only: Draw sorts the live particles back to front (ParticleDepthSort, on the
+    // worker pool) and draws them through an index buffer
+    void SetDepthSort(bool enabled);
+
+    // Not tracked on the CPU in GpuTransformFeedback mode; returns -1 there
+    int GetAliveCount() const { return m_Simulation == ParticleSimulation::Cpu ? m_Pool.GetAliveCount() : -1; }
+    ParticleType GetType() const { return m_Type; }
+    ParticleSimulation GetSimulation() const { return m_Simulation; }
+    int GetMaxParticles() const { return m_MaxParticles; }
+    const ParticleEmitStats& GetEmitStats() const { return m_EmitStats; }
+    // Cpu mode vertex uploads; empty in GpuTransformFeedback mode
+    StreamingBuffer::Stats GetUploadStats() const { return m_Stream ? m_Stream->GetStats() : StreamingBuffer::Stats(); }
+    // Last Draw's sort; empty while depth sorting is off
+    ParticleDepthSort::Stats GetSortStats() const { return m_Sort ? m_Sort->GetStats() : ParticleDepthSort::Stats(); }
     
 private:
     void InitRenderData();
-    int FindUnusedParticle();
+    void InitGpuSimulation();
+    // Uniform lookups and constant uniforms of the GPU programs; each shader runs its own once
+    // the program has finished building (first Update/Draw), so startup never waits for them
+    void SetupGpuUpdateProgram();
+    void SetupGpuDrawProgram();
+    void UpdateGpu(float deltaTime);
+    void DrawGpu();
+    // Integrates [begin, end) and writes their vertices; safe to run on disjoint ranges concurrently
+    void UpdateRange(int begin, int end, float deltaTime);
+    void WriteVertices(int begin, int end);
+    // Kills or splashes the particles in [begin, end) that are below the terrain
+    void CollideRange(int begin, int end);
+    // Slot for one new particle, or -1 when the pool is full and the policy drops it
+    int ClaimSlot();
     
     ParticleType m_Type;
-    std::vector<Particle> m_Particles;
+    ParticleSimulation m_Simulation;
     int m_MaxParticles;
-    int m_LastUsedParticle;
+    ParticleEmitStats m_EmitStats;
+    Pcg32 m_Random;
+
+    // Simulation state (Cpu mode)
+    ParticlePool m_Pool;
+    // Upload staging, index-aligned with the pool: Emit writes new particles, Update every live one
+    std::vector<ParticleVertex> m_Vertices;
     
     // Emitter properties
     float m_EmissionRate;
+    float m_EmissionCarry = 0.0f;   // fractional particle owed by EmitVolumeOverTime
     float m_ParticleLife;
     float m_ParticleSize;
     glm::vec3 m_Gravity;
+    glm::vec4 m_Color;
+
+    ParticleCollision m_Collision = ParticleCollision::None;
+    const class InfiniteTerrain* m_CollisionTerrain = nullptr;
+    const class SceneDepthCopy* m_CollisionDepth = nullptr;
+    float m_SplashLife = 0.3f;
+    uint32_t m_SplashSeed = 0;   // varies the splash directions per Update
+
+    class ThreadPool* m_Workers = nullptr;
+    int m_ParallelThreshold = 32768;
     
     // Rendering
-    unsigned int m_VAO, m_VBO;
+    unsigned int m_VAO = 0;
+    std::unique_ptr<StreamingBuffer> m_Stream;
+    // Depth sorting: draw order, streamed as GL_UNSIGNED_INT indices
+    std::unique_ptr<ParticleDepthSort> m_Sort;
+    std::unique_ptr<StreamingBuffer> m_IndexStream;
+
+    // GpuTransformFeedback: ping-pong state buffers (vec4 position + life, vec4 velocity + size
+    // per slot), each with a VAO used both as update input and for drawing
+    struct GpuEmitter {
+        glm::vec3 center, halfExtent, velocity;
+        int count;
+    };
+    unsigned int m_GpuBuffers[2] = { 0, 0 };
+    unsigned int m_GpuVAOs[2] = { 0, 0 };
+    int m_GpuCurrent = 0;        // buffer holding the latest state
+    int m_GpuEmitStart = 0;      // start of the next emission window
+    uint32_t m_GpuFrame = 0;
+    std::vector<GpuEmitter> m_GpuEmitters;   // requests since the last Update
+    bool m_GpuEmitterWarning = false;
+    std::unique_ptr<class Shader> m_GpuUpdateShader;
+    std::unique_ptr<class Shader> m_GpuDrawShader;
+    struct GpuUpdateUniforms {
+        GLint deltaTime = -1, gravity = -1, lifetime = -1, particleSize = -1, sway = -1, spread = -1;
+        GLint emitStart = -1, emitterCount = -1, seed = -1;
+        GLint emitEnd = -1, emitCenter = -1, emitHalfExtent = -1, emitVelocity = -1;
+        GLint collisionMode = -1, collisionViewProjection = -1, nearPlane = -1, farPlane = -1, splashLife = -1;
+    } m_GpuUpdateUniforms;
+    struct GpuDrawUniforms {
+        GLint particleColor = -1, lifetime = -1, splashLife = -1, alphaScale = -1, sizeGrowth = -1;
+    } m_GpuDrawUniforms;
 };
@@ -218,7 +218,11 @@ void Plane::Draw(Shader& shader, glm::vec3 position, glm::vec3 direction, float
     animatedRoll += sin(m_Time * 1.2f) * 0.015f;
     model = glm::rotate(model, animatedRoll, glm::vec3(0.0f, 0.0f, 1.0f));
 
-    shader.setMat4("model", model);
+    if (m_ModelProgram != shader.ID) {
+        m_ModelProgram = shader.ID;
+        m_ModelLocation = shader.GetUniform("model");
+    }
+    shader.setMat4(m_ModelLocation, model);
 
     glBindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, m_VertexCount);
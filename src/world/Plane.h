@@ -15,6 +15,9 @@ private:
     unsigned int VAO, VBO;
     int m_VertexCount = 0;
     void setupMesh();
+    // "model" in the program last drawn with, looked up again only when the program changes
+    unsigned int m_ModelProgram = 0;
+    int m_ModelLocation = -1;
     
     // Animation state
     float m_Time = 0.0f;
@@ -10,12 +10,16 @@ Skybox::Skybox(const std::vector<std::string>& faces) {
     cubemapTexture = loadCubemap(faces);
 }
 
+// Out of line so the header can leave Shader incomplete
+Skybox::~Skybox() = default;
+
 void Skybox::setupShader() {
-    // We'll use a simple internal shader compilation here or load from file
-    // For consistency, let's assume we use the Shader class but we need to manage the ID manually 
-    // or just use the Shader class instance. 
-    // To keep it simple and robust, I'll use the Shader class helper but I need to store the ID.
-    // Actually, let's just use the Shader class in Draw.
+    // Built with the other programs at startup rather than on the first Draw
+    m_Shader = std::make_unique<Shader>("assets/shaders/skybox.vert", "assets/shaders/skybox.frag");
+    m_Shader->OnFinish([this] {
+        m_ViewLocation = m_Shader->GetUniform("view");
+        m_ProjectionLocation = m_Shader->GetUniform("projection");
+    });
 }
 
 void Skybox::setupMesh() {
@@ -101,19 +105,13 @@ unsigned int Skybox::loadCubemap(std::vector<std::string> faces) {
 }
 
 void Skybox::Draw(const glm::mat4& view, const glm::mat4& projection) {
-    // We need a shader instance here. 
-    // For simplicity, we will create a static shader instance or pass it in.
-    // But to keep the API clean as requested, let's assume we have a shader ready.
-    // Actually, let's just use a local static shader for now to avoid passing it around.
-    static Shader skyboxShader("assets/shaders/skybox.vert", "assets/shaders/skybox.frag");
-
     glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-    skyboxShader.use();
+    m_Shader->use();
     
     // Remove translation from view matrix
     glm::mat4 viewNoTrans = glm::mat4(glm::mat3(view)); 
-    skyboxShader.setMat4("view", viewNoTrans);
-    skyboxShader.setMat4("projection", projection);
+    m_Shader->setMat4(m_ViewLocation, viewNoTrans);
+    m_Shader->setMat4(m_ProjectionLocation, projection);
 
     glBindVertexArray(skyboxVAO);
     glActiveTexture(GL_TEXTURE0);
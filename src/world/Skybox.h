@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <vector>
 #include <string>
 #include <glad/glad.h>
@@ -7,7 +8,10 @@
 class Skybox {
 public:
     Skybox(const std::vector<std::string>& faces);
+    ~Skybox();
     void Draw(const glm::mat4& view, const glm::mat4& projection);
+    // For the startup wait on programs still building
+    const class Shader& GetShader() const { return *m_Shader; }
 
 private:
     unsigned int skyboxVAO, skyboxVBO;
@@ -16,4 +20,7 @@ private:
     unsigned int loadCubemap(std::vector<std::string> faces);
     void setupMesh();
     void setupShader();
+
+    std::unique_ptr<class Shader> m_Shader;
+    GLint m_ViewLocation = -1, m_ProjectionLocation = -1;
 };
@@ -74,7 +74,11 @@ void Stars::Draw(unsigned int shaderProgram, float visibility) {
     glEnable(GL_PROGRAM_POINT_SIZE);
     
     glUseProgram(shaderProgram);
-    glUniform1f(glGetUniformLocation(shaderProgram, "starVisibility"), visibility);
+    if (m_Program != shaderProgram) {
+        m_Program = shaderProgram;
+        m_VisibilityLocation = glGetUniformLocation(shaderProgram, "starVisibility");
+    }
+    glUniform1f(m_VisibilityLocation, visibility);
     
     glBindVertexArray(m_VAO);
     glDrawArrays(GL_POINTS, 0, m_StarCount);
@@ -13,4 +13,7 @@ private:
     unsigned int m_VAO, m_VBO;
     int m_StarCount;
     void GenerateStars();
+    // "starVisibility" in the program last drawn with, looked up again only when the program changes
+    unsigned int m_Program = 0;
+    GLint m_VisibilityLocation = -1;
 };
@@ -0,0 +1,418 @@
+#include "TerrainNoise.h"
+#include "NoiseFbm.h"
+#include "../core/CpuFeatures.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TERRAIN_NOISE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(TERRAIN_NOISE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TERRAIN_NOISE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TERRAIN_NOISE_TARGET(isa)
+#endif
+
+namespace TerrainNoise {
+
+typedef TerrainFbmParams Params;
+
+static std::atomic<int> s_Backend((int)NoiseBackend::Legacy);
+static std::atomic<uint32_t> s_Seed(0);
+
+void SetBackend(NoiseBackend backend, uint32_t seed) {
+    s_Backend.store((int)backend, std::memory_order_relaxed);
+    s_Seed.store(seed, std::memory_order_relaxed);
+}
+
+NoiseBackend GetBackend() {
+    return (NoiseBackend)s_Backend.load(std::memory_order_relaxed);
+}
+
+uint32_t GetSeed() {
+    return GetBackend() == NoiseBackend::Legacy ? 0u : s_Seed.load(std::memory_order_relaxed);
+}
+
+const char* GetBackendName(NoiseBackend backend) {
+    switch (backend) {
+        case NoiseBackend::IntegerHash: return "IntegerHash";
+        default: return "Legacy";
+    }
+}
+
+uint32_t ParamsHash() {
+    // Bump NoiseVersion whenever the noise changes in a way the parameters below do not show
+    const uint32_t NoiseVersion = 2;
+    const float params[] = { (float)NoiseVersion, (float)GetBackend(), (float)Params::Octaves, Params::BaseFrequency,
+                             Params::Gain, Params::Lacunarity, Params::HeightScale, Params::HeightOffset };
+    uint32_t hash = 2166136261u;
+    const unsigned char* bytes = (const unsigned char*)params;
+    for (size_t i = 0; i < sizeof(params); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// --- 更仿真的分形布朗运动（fbm）噪声 ---
+// fbm多层叠加; the octave loop is unrolled at compile time (NoiseFbm.h)
+float Fbm(float x, float z) {
+    if (GetBackend() == NoiseBackend::IntegerHash) {
+        return Fbm<IntegerHash, Params>(x, z, GetSeed());
+    }
+    return Fbm<LegacyHash, Params>(x, z, 0);
+}
+
+float FbmDerivatives(float x, float z, float* dHdx, float* dHdz) {
+    if (GetBackend() == NoiseBackend::IntegerHash) {
+        return FbmDerivatives<IntegerHash, Params>(x, z, GetSeed(), dHdx, dHdz);
+    }
+    return FbmDerivatives<LegacyHash, Params>(x, z, 0, dHdx, dHdz);
+}
+
+// --- Batched evaluation ---
+
+// One output row of one octave:
+// sum[i] += (lerp(a0, b0, u) * (1 - v) + lerp(a1, b1, u) * v) * amp
+// where a0/b0 are the lattice values left/right of sample i on lattice row iz, a1/b1 on iz + 1.
+// The operation order mirrors valueNoise() so the result matches the scalar path exactly.
+typedef void (*RowKernel)(const float* a0, const float* b0, const float* a1, const float* b1,
+                          const float* u, const float* oneMinusU, float v, float amp,
+                          float* sum, int count);
+
+static void AccumulateRowScalar(const float* a0, const float* b0, const float* a1, const float* b1,
+                                const float* u, const float* oneMinusU, float v, float amp,
+                                float* sum, int count) {
+    float oneMinusV = 1 - v;
+    for (int i = 0; i < count; ++i) {
+        float a = a0[i] * oneMinusU[i] + b0[i] * u[i];
+        float b = a1[i] * oneMinusU[i] + b1[i] * u[i];
+        sum[i] += (a * oneMinusV + b * v) * amp;
+    }
+}
+
+// Same as RowKernel, plus the derivative sums:
+// sumDx[i] += ((b0 - a0) * (1 - v) + (b1 - a1) * v) * du[i] * ampFreq
+// sumDz[i] += (lerp(a1, b1, u) - lerp(a0, b0, u)) * dv * ampFreq
+struct DerivativeRowArgs {
+    const float* a0; const float* b0; const float* a1; const float* b1;
+    const float* u; const float* oneMinusU; const float* du;
+    float v, dv, amp, ampFreq;
+    float* sum; float* sumDx; float* sumDz;
+};
+typedef void (*DerivativeRowKernel)(const DerivativeRowArgs& args, int begin, int count);
+
+static void AccumulateDerivativeRowScalar(const DerivativeRowArgs& p, int begin, int count) {
+    float oneMinusV = 1 - p.v;
+    for (int i = begin; i < count; ++i) {
+        float a = p.a0[i] * p.oneMinusU[i] + p.b0[i] * p.u[i];
+        float b = p.a1[i] * p.oneMinusU[i] + p.b1[i] * p.u[i];
+        p.sum[i] += (a * oneMinusV + b * p.v) * p.amp;
+        p.sumDx[i] += ((p.b0[i] - p.a0[i]) * oneMinusV + (p.b1[i] - p.a1[i]) * p.v) * p.du[i] * p.ampFreq;
+        p.sumDz[i] += (b - a) * p.dv * p.ampFreq;
+    }
+}
+
+#ifdef TERRAIN_NOISE_X86
+TERRAIN_NOISE_TARGET("sse2")
+static void AccumulateRowSSE2(const float* a0, const float* b0, const float* a1, const float* b1,
+                              const float* u, const float* oneMinusU, float v, float amp,
+                              float* sum, int count) {
+    const __m128 vv = _mm_set1_ps(v);
+    const __m128 vOneMinusV = _mm_set1_ps(1 - v);
+    const __m128 vAmp = _mm_set1_ps(amp);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 vu = _mm_loadu_ps(u + i);
+        __m128 vw = _mm_loadu_ps(oneMinusU + i);
+        __m128 a = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a0 + i), vw), _mm_mul_ps(_mm_loadu_ps(b0 + i), vu));
+        __m128 b = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a1 + i), vw), _mm_mul_ps(_mm_loadu_ps(b1 + i), vu));
+        __m128 n = _mm_add_ps(_mm_mul_ps(a, vOneMinusV), _mm_mul_ps(b, vv));
+        _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(n, vAmp)));
+    }
+    AccumulateRowScalar(a0 + i, b0 + i, a1 + i, b1 + i, u + i, oneMinusU + i, v, amp, sum + i, count - i);
+}
+
+TERRAIN_NOISE_TARGET("avx2")
+static void AccumulateRowAVX2(const float* a0, const float* b0, const float* a1, const float* b1,
+                              const float* u, const float* oneMinusU, float v, float amp,
+                              float* sum, int count) {
+    const __m256 vv = _mm256_set1_ps(v);
+    const __m256 vOneMinusV = _mm256_set1_ps(1 - v);
+    const __m256 vAmp = _mm256_set1_ps(amp);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 vu = _mm256_loadu_ps(u + i);
+        __m256 vw = _mm256_loadu_ps(oneMinusU + i);
+        __m256 a = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a0 + i), vw), _mm256_mul_ps(_mm256_loadu_ps(b0 + i), vu));
+        __m256 b = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(a1 + i), vw), _mm256_mul_ps(_mm256_loadu_ps(b1 + i), vu));
+        __m256 n = _mm256_add_ps(_mm256_mul_ps(a, vOneMinusV), _mm256_mul_ps(b, vv));
+        _mm256_storeu_ps(sum + i, _mm256_add_ps(_mm256_loadu_ps(sum + i), _mm256_mul_ps(n, vAmp)));
+    }
+    AccumulateRowScalar(a0 + i, b0 + i, a1 + i, b1 + i, u + i, oneMinusU + i, v, amp, sum + i, count - i);
+}
+
+TERRAIN_NOISE_TARGET("sse2")
+static void AccumulateDerivativeRowSSE2(const DerivativeRowArgs& p, int begin, int count) {
+    const __m128 vv = _mm_set1_ps(p.v);
+    const __m128 vOneMinusV = _mm_set1_ps(1 - p.v);
+    const __m128 vAmp = _mm_set1_ps(p.amp);
+    const __m128 vAmpFreq = _mm_set1_ps(p.ampFreq);
+    const __m128 vDv = _mm_set1_ps(p.dv);
+    int i = begin;
+    for (; i + 4 <= count; i += 4) {
+        __m128 a0 = _mm_loadu_ps(p.a0 + i), b0 = _mm_loadu_ps(p.b0 + i);
+        __m128 a1 = _mm_loadu_ps(p.a1 + i), b1 = _mm_loadu_ps(p.b1 + i);
+        __m128 vu = _mm_loadu_ps(p.u + i);
+        __m128 vw = _mm_loadu_ps(p.oneMinusU + i);
+        __m128 a = _mm_add_ps(_mm_mul_ps(a0, vw), _mm_mul_ps(b0, vu));
+        __m128 b = _mm_add_ps(_mm_mul_ps(a1, vw), _mm_mul_ps(b1, vu));
+        __m128 n = _mm_add_ps(_mm_mul_ps(a, vOneMinusV), _mm_mul_ps(b, vv));
+        _mm_storeu_ps(p.sum + i, _mm_add_ps(_mm_loadu_ps(p.sum + i), _mm_mul_ps(n, vAmp)));
+        __m128 dx = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(b0, a0), vOneMinusV), _mm_mul_ps(_mm_sub_ps(b1, a1), vv));
+        dx = _mm_mul_ps(_mm_mul_ps(dx, _mm_loadu_ps(p.du + i)), vAmpFreq);
+        _mm_storeu_ps(p.sumDx + i, _mm_add_ps(_mm_loadu_ps(p.sumDx + i), dx));
+        __m128 dz = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(b, a), vDv), vAmpFreq);
+        _mm_storeu_ps(p.sumDz + i, _mm_add_ps(_mm_loadu_ps(p.sumDz + i), dz));
+    }
+    AccumulateDerivativeRowScalar(p, i, count);
+}
+
+TERRAIN_NOISE_TARGET("avx2")
+static void AccumulateDerivativeRowAVX2(const DerivativeRowArgs& p, int begin, int count) {
+    const __m256 vv = _mm256_set1_ps(p.v);
+    const __m256 vOneMinusV = _mm256_set1_ps(1 - p.v);
+    const __m256 vAmp = _mm256_set1_ps(p.amp);
+    const __m256 vAmpFreq = _mm256_set1_ps(p.ampFreq);
+    const __m256 vDv = _mm256_set1_ps(p.dv);
+    int i = begin;
+    for (; i + 8 <= count; i += 8) {
+        __m256 a0 = _mm256_loadu_ps(p.a0 + i), b0 = _mm256_loadu_ps(p.b0 + i);
+        __m256 a1 = _mm256_loadu_ps(p.a1 + i), b1 = _mm256_loadu_ps(p.b1 + i);
+        __m256 vu = _mm256_loadu_ps(p.u + i);
+        __m256 vw = _mm256_loadu_ps(p.oneMinusU + i);
+        __m256 a = _mm256_add_ps(_mm256_mul_ps(a0, vw), _mm256_mul_ps(b0, vu));
+        __m256 b = _mm256_add_ps(_mm256_mul_ps(a1, vw), _mm256_mul_ps(b1, vu));
+        __m256 n = _mm256_add_ps(_mm256_mul_ps(a, vOneMinusV), _mm256_mul_ps(b, vv));
+        _mm256_storeu_ps(p.sum + i, _mm256_add_ps(_mm256_loadu_ps(p.sum + i), _mm256_mul_ps(n, vAmp)));
+        __m256 dx = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(b0, a0), vOneMinusV), _mm256_mul_ps(_mm256_sub_ps(b1, a1), vv));
+        dx = _mm256_mul_ps(_mm256_mul_ps(dx, _mm256_loadu_ps(p.du + i)), vAmpFreq);
+        _mm256_storeu_ps(p.sumDx + i, _mm256_add_ps(_mm256_loadu_ps(p.sumDx + i), dx));
+        __m256 dz = _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(b, a), vDv), vAmpFreq);
+        _mm256_storeu_ps(p.sumDz + i, _mm256_add_ps(_mm256_loadu_ps(p.sumDz + i), dz));
+    }
+    AccumulateDerivativeRowScalar(p, i, count);
+}
+#endif
+
+static std::atomic<int> s_ForcedLevel(-1);
+
+static SimdLevel DetectSimdLevel() {
+    const CpuFeatures& cpu = CpuFeatures::Get();
+#ifdef TERRAIN_NOISE_X86
+    if (cpu.avx2) return SimdLevel::AVX2;
+    if (cpu.sse2) return SimdLevel::SSE2;
+#endif
+    (void)cpu;
+    return SimdLevel::Scalar;
+}
+
+SimdLevel GetSimdLevel() {
+    static const SimdLevel detected = DetectSimdLevel();
+    int forced = s_ForcedLevel.load(std::memory_order_relaxed);
+    if (forced >= 0 && forced < (int)detected) return (SimdLevel)forced;
+    return detected;
+}
+
+void SetSimdLevel(SimdLevel level) {
+    s_ForcedLevel.store((int)level, std::memory_order_relaxed);
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE2: return "SSE2";
+        default: return "Scalar";
+    }
+}
+
+static RowKernel SelectRowKernel() {
+    switch (GetSimdLevel()) {
+#ifdef TERRAIN_NOISE_X86
+        case SimdLevel::AVX2: return AccumulateRowAVX2;
+        case SimdLevel::SSE2: return AccumulateRowSSE2;
+#endif
+        default: return AccumulateRowScalar;
+    }
+}
+
+static DerivativeRowKernel SelectDerivativeRowKernel() {
+    switch (GetSimdLevel()) {
+#ifdef TERRAIN_NOISE_X86
+        case SimdLevel::AVX2: return AccumulateDerivativeRowAVX2;
+        case SimdLevel::SSE2: return AccumulateDerivativeRowSSE2;
+#endif
+        default: return AccumulateDerivativeRowScalar;
+    }
+}
+
+// Per-thread scratch so worker threads never allocate in steady state
+struct GridScratch {
+    std::vector<int> colIndex, rowIndex;
+    std::vector<float> u, oneMinusU, du, v, dv;
+    // Lattice values left/right of every column, for the two lattice rows around the current output row
+    std::vector<float> left0, right0, left1, right1;
+};
+
+// Expands one lattice row into per-column corner values; each distinct lattice column is hashed once
+template <class Hash>
+static void FillLatticeRow(typename Hash::Row row, const int* colIndex, int width, float* left, float* right) {
+    bool haveLast = false;
+    int lastIx = 0;
+    float l = 0.0f, r = 0.0f;
+    for (int c = 0; c < width; ++c) {
+        int ix = colIndex[c];
+        if (!haveLast || ix != lastIx) {
+            l = (haveLast && ix == lastIx + 1) ? r : Hash::Value(ix, row);
+            r = Hash::Value(ix + 1, row);
+            lastIx = ix;
+            haveLast = true;
+        }
+        left[c] = l;
+        right[c] = r;
+    }
+}
+
+// Shared tile driver. For every octave it computes the separable column/row terms, walks the
+// rows keeping the two lattice rows around the current one expanded, and hands each output
+// row to accumulateRow(row, octaveAmplitude, octaveFrequency). Returns the amplitude sum.
+template <class Hash, class AccumulateRow>
+static float FbmTile(GridScratch& s, uint32_t seed, float x0, float z0, float step, int width, int height,
+                     AccumulateRow accumulateRow) {
+    s.colIndex.resize(width);
+    s.u.resize(width);
+    s.oneMinusU.resize(width);
+    s.du.resize(width);
+    s.left0.resize(width);
+    s.right0.resize(width);
+    s.left1.resize(width);
+    s.right1.resize(width);
+    s.rowIndex.resize(height);
+    s.v.resize(height);
+    s.dv.resize(height);
+
+    float amplitude = 1.0f;
+    float frequency = Params::BaseFrequency;
+    float maxAmp = 0.0f;
+    for (int octave = 0; octave < Params::Octaves; ++octave) {
+        // Column/row terms are separable: compute them once per octave
+        for (int c = 0; c < width; ++c) {
+            float x = (x0 + c * step) * frequency;
+            int ix = (int)std::floor(x);
+            float fx = x - ix;
+            s.colIndex[c] = ix;
+            s.u[c] = fx * fx * (3.0f - 2.0f * fx);
+            s.oneMinusU[c] = 1 - s.u[c];
+            s.du[c] = 6.0f * fx * (1.0f - fx);
+        }
+        for (int r = 0; r < height; ++r) {
+            float z = (z0 + r * step) * frequency;
+            int iz = (int)std::floor(z);
+            float fz = z - iz;
+            s.rowIndex[r] = iz;
+            s.v[r] = fz * fz * (3.0f - 2.0f * fz);
+            s.dv[r] = 6.0f * fz * (1.0f - fz);
+        }
+
+        bool haveRows = false;
+        int currentIz = 0;
+        for (int r = 0; r < height; ++r) {
+            int iz = s.rowIndex[r];
+            if (!haveRows || iz != currentIz) {
+                if (haveRows && iz == currentIz + 1) {
+                    // Moved up one lattice row: the old upper row becomes the lower one
+                    std::swap(s.left0, s.left1);
+                    std::swap(s.right0, s.right1);
+                } else {
+                    FillLatticeRow<Hash>(Hash::MakeRow(iz, octave, seed), s.colIndex.data(), width,
+                                         s.left0.data(), s.right0.data());
+                }
+                FillLatticeRow<Hash>(Hash::MakeRow(iz + 1, octave, seed), s.colIndex.data(), width,
+                                     s.left1.data(), s.right1.data());
+                currentIz = iz;
+                haveRows = true;
+            }
+            accumulateRow(r, amplitude, frequency);
+        }
+
+        maxAmp += amplitude;
+        amplitude *= Params::Gain;
+        frequency *= Params::Lacunarity;
+    }
+    return maxAmp;
+}
+
+// Runs FbmTile with the hash of the selected backend
+template <class AccumulateRow>
+static float FbmTileForBackend(GridScratch& s, float x0, float z0, float step, int width, int height,
+                               AccumulateRow accumulateRow) {
+    if (GetBackend() == NoiseBackend::IntegerHash) {
+        return FbmTile<IntegerHash>(s, GetSeed(), x0, z0, step, width, height, accumulateRow);
+    }
+    return FbmTile<LegacyHash>(s, 0, x0, z0, step, width, height, accumulateRow);
+}
+
+void FbmGrid(float x0, float z0, float step, int width, int height, float* out) {
+    if (width <= 0 || height <= 0) return;
+    RowKernel kernel = SelectRowKernel();
+    thread_local GridScratch s;
+    size_t count = (size_t)width * height;
+    std::fill(out, out + count, 0.0f);
+
+    float maxAmp = FbmTileForBackend(s, x0, z0, step, width, height, [&](int r, float amplitude, float) {
+        kernel(s.left0.data(), s.right0.data(), s.left1.data(), s.right1.data(),
+               s.u.data(), s.oneMinusU.data(), s.v[r], amplitude, out + (size_t)r * width, width);
+    });
+
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = out[i] / maxAmp * Params::HeightScale + Params::HeightOffset;
+    }
+}
+
+void FbmGridDerivatives(float x0, float z0, float step, int width, int height,
+                        float* outHeight, float* outDx, float* outDz) {
+    if (width <= 0 || height <= 0) return;
+    DerivativeRowKernel kernel = SelectDerivativeRowKernel();
+    thread_local GridScratch s;
+    size_t count = (size_t)width * height;
+    std::fill(outHeight, outHeight + count, 0.0f);
+    std::fill(outDx, outDx + count, 0.0f);
+    std::fill(outDz, outDz + count, 0.0f);
+
+    float maxAmp = FbmTileForBackend(s, x0, z0, step, width, height, [&](int r, float amplitude, float frequency) {
+        DerivativeRowArgs args;
+        args.a0 = s.left0.data(); args.b0 = s.right0.data();
+        args.a1 = s.left1.data(); args.b1 = s.right1.data();
+        args.u = s.u.data(); args.oneMinusU = s.oneMinusU.data(); args.du = s.du.data();
+        args.v = s.v[r];
+        args.dv = s.dv[r];
+        args.amp = amplitude;
+        args.ampFreq = amplitude * frequency;
+        size_t offset = (size_t)r * width;
+        args.sum = outHeight + offset;
+        args.sumDx = outDx + offset;
+        args.sumDz = outDz + offset;
+        kernel(args, 0, width);
+    });
+
+    for (size_t i = 0; i < count; ++i) {
+        outHeight[i] = outHeight[i] / maxAmp * Params::HeightScale + Params::HeightOffset;
+        outDx[i] = outDx[i] / maxAmp * Params::HeightScale;
+        outDz[i] = outDz[i] / maxAmp * Params::HeightScale;
+    }
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+
+// Fractal value noise (fBm) used for the infinite terrain heightfield.
+//
+// Fbm() evaluates a single point. FbmGrid() fills a whole regular tile in one call: each
+// octave's lattice corners are hashed once for the tile instead of four times per sample,
+// and the interpolation/accumulation runs in SSE2 or AVX2 kernels picked at runtime.
+//
+// Accuracy: FbmGrid performs the same float operations in the same order as Fbm, so on
+// x86 builds without FMA contraction the results are bit-identical. The documented
+// tolerance is |FbmGrid - Fbm| <= FbmGridTolerance (height units), which leaves room for
+// compilers that fuse multiply-adds.
+//
+// The *Derivatives variants also return the analytic partial derivatives dH/dx and dH/dz
+// from the same pass (the smoothstep interpolant is differentiable everywhere), so normals
+// cost no extra noise evaluations. They depend only on the world position, so vertices
+// shared by two chunks get identical normals.
+namespace TerrainNoise {
+
+constexpr float FbmGridTolerance = 1e-4f;
+// Bounds of every Fbm() output (octave values lie in (-1, 1))
+constexpr float MinHeight = -110.0f;
+constexpr float MaxHeight = 90.0f;
+
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+// Lattice hash behind every function below (see NoiseFbm.h).
+// Legacy: the original sin() hash, unseeded. IntegerHash: seeded PCG hash, faster and exact
+// at any distance from the origin. Select before generating terrain; the default is Legacy.
+enum class NoiseBackend { Legacy, IntegerHash };
+
+void SetBackend(NoiseBackend backend, uint32_t seed = 0);
+NoiseBackend GetBackend();
+// Seed in effect (always 0 for Legacy)
+uint32_t GetSeed();
+const char* GetBackendName(NoiseBackend backend);
+
+// Identifies the current noise configuration (algorithm version, backend, octaves, frequencies, scale),
+// so persisted terrain from a different configuration is not reused
+uint32_t ParamsHash();
+
+// Height at a world position (same output as the original InfiniteTerrain::Noise)
+float Fbm(float x, float z);
+
+// Height plus its partial derivatives at a world position
+float FbmDerivatives(float x, float z, float* dHdx, float* dHdz);
+
+// out[row * width + col] = Fbm(x0 + col * step, z0 + row * step); step must be > 0
+void FbmGrid(float x0, float z0, float step, int width, int height, float* out);
+// Same tile layout as FbmGrid; heights match FbmGrid, derivatives go to outDx/outDz
+void FbmGridDerivatives(float x0, float z0, float step, int width, int height,
+                        float* outHeight, float* outDx, float* outDz);
+
+// Best level supported by this CPU, or the level forced with SetSimdLevel
+SimdLevel GetSimdLevel();
+// Caps the kernel used by FbmGrid (clamped to what the CPU supports); for comparisons
+void SetSimdLevel(SimdLevel level);
+const char* GetSimdLevelName(SimdLevel level);
+
+}
@@ -0,0 +1,194 @@
+#include "TerrainTileCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+static const char CacheMagic[8] = { 'S', 'K', 'Y', 'T', 'I', 'L', 'E', 'S' };
+static const uint32_t CacheVersion = 1;
+
+TerrainTileCache::TerrainTileCache(const std::string& path, size_t maxBytes, int vertsPerSide, uint32_t seed, uint32_t paramsHash)
+    : m_VertsPerSide(vertsPerSide), m_Seed(seed), m_ParamsHash(paramsHash) {
+    size_t vertexCount = (size_t)vertsPerSide * vertsPerSide;
+    m_RecordBytes = 2 * sizeof(float) + vertexCount * sizeof(uint16_t) + vertexCount * 2 * sizeof(int16_t);
+    m_RecordBytes = (m_RecordBytes + 7) & ~(size_t)7;
+    m_Capacity = (uint32_t)((maxBytes - std::min(maxBytes, sizeof(Header))) / (sizeof(Entry) + m_RecordBytes));
+    if (m_Capacity == 0) {
+        std::cerr << "[TerrainTileCache] " << maxBytes << " bytes is too small for a single tile, cache disabled" << std::endl;
+        return;
+    }
+    m_EntriesOffset = sizeof(Header);
+    m_RecordsOffset = m_EntriesOffset + m_Capacity * sizeof(Entry);
+    if (!m_File.Open(path, m_RecordsOffset + m_Capacity * m_RecordBytes)) {
+        std::cerr << "[TerrainTileCache] Cache disabled" << std::endl;
+        return;
+    }
+    
+    Header* header = GetHeader();
+    if (memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) != 0 || header->version != CacheVersion ||
+        header->vertsPerSide != (uint32_t)vertsPerSide || header->capacity != m_Capacity ||
+        header->recordBytes != (uint32_t)m_RecordBytes) {
+        Reset();
+        std::cout << "[TerrainTileCache] Created " << path << " (" << m_Capacity << " tiles, "
+                  << m_File.GetSize() / (1024 * 1024) << " MB)" << std::endl;
+        return;
+    }
+    
+    m_LruPrev.assign(m_Capacity, -1);
+    m_LruNext.assign(m_Capacity, -1);
+    std::vector<int> valid;
+    for (uint32_t i = 0; i < m_Capacity; ++i) {
+        Entry* entry = GetEntry((int)i);
+        if (entry->valid) {
+            m_Index[RecordKey{entry->seed, entry->paramsHash, entry->level, entry->x, entry->z}] = (int)i;
+            valid.push_back((int)i);
+        } else {
+            m_FreeRecords.push_back((int)i);
+        }
+    }
+    // Oldest first, so the least recently used record ends up at the tail
+    std::sort(valid.begin(), valid.end(), [this](int a, int b) {
+        return GetEntry(a)->lastUsed < GetEntry(b)->lastUsed;
+    });
+    for (int index : valid) {
+        LruPushFront(index);
+    }
+    std::cout << "[TerrainTileCache] Opened " << path << " (" << m_Index.size() << " / " << m_Capacity << " tiles)" << std::endl;
+}
+
+TerrainTileCache::Entry* TerrainTileCache::GetEntry(int index) const {
+    return (Entry*)(m_File.GetData() + m_EntriesOffset + (size_t)index * sizeof(Entry));
+}
+
+uint8_t* TerrainTileCache::GetRecord(int index) const {
+    return m_File.GetData() + m_RecordsOffset + (size_t)index * m_RecordBytes;
+}
+
+void TerrainTileCache::Reset() {
+    Header* header = GetHeader();
+    memcpy(header->magic, CacheMagic, sizeof(CacheMagic));
+    header->version = CacheVersion;
+    header->vertsPerSide = (uint32_t)m_VertsPerSide;
+    header->capacity = m_Capacity;
+    header->recordBytes = (uint32_t)m_RecordBytes;
+    header->tick = 0;
+    memset(GetEntry(0), 0, m_Capacity * sizeof(Entry));
+    m_Index.clear();
+    m_FreeRecords.clear();
+    m_LruPrev.assign(m_Capacity, -1);
+    m_LruNext.assign(m_Capacity, -1);
+    m_LruHead = m_LruTail = -1;
+    for (int i = (int)m_Capacity - 1; i >= 0; --i) {
+        m_FreeRecords.push_back(i);
+    }
+}
+
+int TerrainTileCache::AllocateRecord() {
+    if (!m_FreeRecords.empty()) {
+        int index = m_FreeRecords.back();
+        m_FreeRecords.pop_back();
+        return index;
+    }
+    // Full: overwrite the least recently used record
+    int victim = m_LruTail;
+    LruUnlink(victim);
+    Entry* entry = GetEntry(victim);
+    m_Index.erase(RecordKey{entry->seed, entry->paramsHash, entry->level, entry->x, entry->z});
+    entry->valid = 0;
+    m_Stats.evictions++;
+    return victim;
+}
+
+void TerrainTileCache::LruUnlink(int index) {
+    int prev = m_LruPrev[index];
+    int next = m_LruNext[index];
+    if (prev >= 0) m_LruNext[prev] = next; else m_LruHead = next;
+    if (next >= 0) m_LruPrev[next] = prev; else m_LruTail = prev;
+    m_LruPrev[index] = m_LruNext[index] = -1;
+}
+
+void TerrainTileCache::LruPushFront(int index) {
+    m_LruPrev[index] = -1;
+    m_LruNext[index] = m_LruHead;
+    if (m_LruHead >= 0) m_LruPrev[m_LruHead] = index; else m_LruTail = index;
+    m_LruHead = index;
+}
+
+bool TerrainTileCache::Load(const ChunkKey& key, float* heights, int16_t* normals) {
+    if (!IsOpen()) return false;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Index.find(MakeKey(key));
+    if (it == m_Index.end()) {
+        m_Stats.misses++;
+        return false;
+    }
+    GetEntry(it->second)->lastUsed = ++GetHeader()->tick;
+    LruUnlink(it->second);
+    LruPushFront(it->second);
+    
+    const uint8_t* record = GetRecord(it->second);
+    size_t vertexCount = (size_t)m_VertsPerSide * m_VertsPerSide;
+    float range[2];
+    memcpy(range, record, sizeof(range));
+    const uint16_t* quantized = (const uint16_t*)(record + sizeof(range));
+    float scale = (range[1] - range[0]) / 65535.0f;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        heights[i] = range[0] + quantized[i] * scale;
+    }
+    memcpy(normals, record + sizeof(range) + vertexCount * sizeof(uint16_t), vertexCount * 2 * sizeof(int16_t));
+    m_Stats.hits++;
+    return true;
+}
+
+void TerrainTileCache::Store(const ChunkKey& key, const float* heights, const int16_t* normals) {
+    if (!IsOpen()) return;
+    size_t vertexCount = (size_t)m_VertsPerSide * m_VertsPerSide;
+    
+    // Quantize outside the lock
+    auto minmax = std::minmax_element(heights, heights + vertexCount);
+    float range[2] = { *minmax.first, *minmax.second };
+    float scale = range[1] > range[0] ? 65535.0f / (range[1] - range[0]) : 0.0f;
+    std::vector<uint16_t> quantized(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        quantized[i] = (uint16_t)std::lround((heights[i] - range[0]) * scale);
+    }
+    
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    RecordKey recordKey = MakeKey(key);
+    auto it = m_Index.find(recordKey);
+    int index;
+    if (it != m_Index.end()) {
+        index = it->second;
+        LruUnlink(index);
+    } else {
+        index = AllocateRecord();
+    }
+    
+    uint8_t* record = GetRecord(index);
+    memcpy(record, range, sizeof(range));
+    memcpy(record + sizeof(range), quantized.data(), vertexCount * sizeof(uint16_t));
+    memcpy(record + sizeof(range) + vertexCount * sizeof(uint16_t), normals, vertexCount * 2 * sizeof(int16_t));
+    
+    // Entry last, so a record is only marked valid once its data is written
+    Entry* entry = GetEntry(index);
+    entry->seed = recordKey.seed;
+    entry->paramsHash = recordKey.paramsHash;
+    entry->level = recordKey.level;
+    entry->x = recordKey.x;
+    entry->z = recordKey.z;
+    entry->lastUsed = ++GetHeader()->tick;
+    entry->valid = 1;
+    m_Index[recordKey] = index;
+    LruPushFront(index);
+    m_Stats.writes++;
+}
+
+TerrainTileCache::Stats TerrainTileCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+size_t TerrainTileCache::GetTileCount() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Index.size();
+}
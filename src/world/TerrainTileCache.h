@@ -0,0 +1,112 @@
+#pragma once
+#include "HeightTileIndex.h"
+#include "../core/MappedFile.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Persistent cache of generated terrain nodes in one memory-mapped file, so revisiting an area
+// or restarting skips the noise evaluation.
+//
+// File layout (little-endian, all sizes fixed when the file is created):
+//   Header
+//   Entry[capacity]            key + LRU tick per record, valid == 0 marks a free record
+//   Record[capacity]           min/max height, heights quantized to uint16 over [min, max],
+//                              normals as snorm16 x/z pairs (same encoding as TerrainVertex)
+// A file whose version, grid size or capacity does not match is wiped and rebuilt.
+// Entries carry the noise seed and parameter hash, so one file can hold several worlds and
+// records from an older noise configuration are never returned.
+//
+// Load/Store are thread-safe and meant to be called from the terrain worker jobs.
+class TerrainTileCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t writes = 0;
+        uint64_t evictions = 0;     // least recently used records overwritten
+    };
+
+    // maxBytes caps the file size; the record count is derived from it
+    TerrainTileCache(const std::string& path, size_t maxBytes, int vertsPerSide, uint32_t seed, uint32_t paramsHash);
+
+    TerrainTileCache(const TerrainTileCache&) = delete;
+    TerrainTileCache& operator=(const TerrainTileCache&) = delete;
+
+    bool IsOpen() const { return m_File.IsOpen(); }
+
+    // heights: vertsPerSide^2 floats, normals: 2 * vertsPerSide^2 snorm16 (x, z) values
+    bool Load(const ChunkKey& key, float* heights, int16_t* normals);
+    void Store(const ChunkKey& key, const float* heights, const int16_t* normals);
+
+    Stats GetStats() const;
+    size_t GetTileCount() const;
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t vertsPerSide;
+        uint32_t capacity;
+        uint32_t recordBytes;
+        uint64_t tick;          // LRU clock, advanced on every hit or write
+    };
+
+    struct Entry {
+        uint32_t seed;
+        uint32_t paramsHash;
+        int32_t level;
+        int32_t x, z;
+        uint32_t valid;
+        uint64_t lastUsed;
+    };
+
+    struct RecordKey {
+        uint32_t seed, paramsHash;
+        int32_t level, x, z;
+        bool operator==(const RecordKey& other) const {
+            return seed == other.seed && paramsHash == other.paramsHash && level == other.level &&
+                   x == other.x && z == other.z;
+        }
+    };
+
+    struct RecordKeyHash {
+        size_t operator()(const RecordKey& k) const {
+            uint64_t h = 1469598103934665603ull;
+            const uint32_t parts[5] = { k.seed, k.paramsHash, (uint32_t)k.level, (uint32_t)k.x, (uint32_t)k.z };
+            for (uint32_t part : parts) {
+                h = (h ^ part) * 1099511628211ull;
+            }
+            return (size_t)h;
+        }
+    };
+
+    Header* GetHeader() const { return (Header*)m_File.GetData(); }
+    Entry* GetEntry(int index) const;
+    uint8_t* GetRecord(int index) const;
+    RecordKey MakeKey(const ChunkKey& key) const { return RecordKey{m_Seed, m_ParamsHash, key.level, key.x, key.z}; }
+    void Reset();
+    int AllocateRecord();
+    // Recency list over the valid records: head is the most recently used, tail the eviction victim
+    void LruUnlink(int index);
+    void LruPushFront(int index);
+
+    MappedFile m_File;
+    int m_VertsPerSide;
+    uint32_t m_Seed;
+    uint32_t m_ParamsHash;
+    uint32_t m_Capacity = 0;
+    size_t m_RecordBytes = 0;
+    size_t m_EntriesOffset = 0;
+    size_t m_RecordsOffset = 0;
+
+    mutable std::mutex m_Mutex;
+    std::unordered_map<RecordKey, int, RecordKeyHash> m_Index;
+    std::vector<int> m_FreeRecords;
+    // In memory only, rebuilt from Entry::lastUsed on open; links are record indices, -1 for none
+    std::vector<int> m_LruPrev, m_LruNext;
+    int m_LruHead = -1, m_LruTail = -1;
+    Stats m_Stats;
+};
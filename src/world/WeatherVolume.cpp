@@ -0,0 +1,121 @@
+#include "WeatherVolume.h"
+#include "../core/Random.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Wraps x into [0, size)
+float WrapUnit(float x, float size) {
+    float r = std::fmod(x, size);
+    return r < 0.0f ? r + size : r;
+}
+
+}
+
+WeatherVolume::WeatherVolume(int particleCount, const glm::vec3& size, uint32_t seed)
+    : m_ParticleCount(particleCount), m_Size(size)
+{
+    SetType(ParticleType::Rain);
+
+    // Seed in [0,1)^3 plus a per-point variation used for size and sway phase
+    Pcg32 random(seed);
+    std::vector<float> seeds((size_t)particleCount * 4);
+    for (int i = 0; i < particleCount; i++) {
+        seeds[i * 4 + 0] = random.NextFloat01();
+        seeds[i * 4 + 1] = random.NextFloat01();
+        seeds[i * 4 + 2] = random.NextFloat01();
+        seeds[i * 4 + 3] = random.NextFloat01();
+    }
+
+    glGenVertexArrays(1, &m_VAO);
+    glGenBuffers(1, &m_VBO);
+
+    glBindVertexArray(m_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferData(GL_ARRAY_BUFFER, seeds.size() * sizeof(float), seeds.data(), GL_STATIC_DRAW);
+
+    // Seed, read as particle.vert's aPos
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+    // Variation, read as aSize; aColor (location 1) is unused by the wrapVolume path
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(3 * sizeof(float)));
+
+    glBindVertexArray(0);
+}
+
+WeatherVolume::~WeatherVolume() {
+    glDeleteVertexArrays(1, &m_VAO);
+    glDeleteBuffers(1, &m_VBO);
+}
+
+void WeatherVolume::SetType(ParticleType type) {
+    m_Type = type;
+    if (type == ParticleType::Snow) {
+        m_Velocity = glm::vec3(0.0f, -2.5f, 0.0f);
+        m_Color = glm::vec4(1.0f, 1.0f, 1.0f, 0.9f);
+        m_PointSize = 4.0f;
+        m_SwayAmount = 1.5f;
+    } else {
+        // Same colours and sizes as ParticleSystem's Rain defaults
+        m_Velocity = glm::vec3(0.0f, -40.0f, 0.0f);
+        m_Color = glm::vec4(0.7f, 0.8f, 1.0f, 0.6f);
+        m_PointSize = 2.0f;
+        m_SwayAmount = 0.0f;
+    }
+}
+
+void WeatherVolume::Update(float deltaTime) {
+    m_Offset.x = WrapUnit(m_Offset.x + m_Velocity.x * deltaTime, m_Size.x);
+    m_Offset.y = WrapUnit(m_Offset.y + m_Velocity.y * deltaTime, m_Size.y);
+    m_Offset.z = WrapUnit(m_Offset.z + m_Velocity.z * deltaTime, m_Size.z);
+    // particle.vert sways with sin(phase) and cos(0.7 * phase); 20*pi is a whole number of
+    // periods of both, so wrapping there keeps the motion continuous
+    m_SwayPhase = WrapUnit(m_SwayPhase + deltaTime, 62.831853f);
+}
+
+void WeatherVolume::Draw(unsigned int shaderProgram, const glm::vec3& cameraPos) {
+    // The box is scrolled by m_Offset and anchored to the camera; fold both into one shift in
+    // [0, size) here, where the world-space camera position is still exact
+    glm::vec3 shift(WrapUnit(m_Offset.x - cameraPos.x, m_Size.x),
+                    WrapUnit(m_Offset.y - cameraPos.y, m_Size.y),
+                    WrapUnit(m_Offset.z - cameraPos.z, m_Size.z));
+
+    // Same blending as ParticleSystem, so it can share a LowResParticlePass
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    glUseProgram(shaderProgram);
+    if (m_Uniforms.program != shaderProgram) {
+        m_Uniforms.program = shaderProgram;
+        m_Uniforms.wrapVolume = glGetUniformLocation(shaderProgram, "wrapVolume");
+        m_Uniforms.volumeSize = glGetUniformLocation(shaderProgram, "volumeSize");
+        m_Uniforms.volumeShift = glGetUniformLocation(shaderProgram, "volumeShift");
+        m_Uniforms.swayPhase = glGetUniformLocation(shaderProgram, "swayPhase");
+        m_Uniforms.swayAmount = glGetUniformLocation(shaderProgram, "swayAmount");
+        m_Uniforms.weatherColor = glGetUniformLocation(shaderProgram, "weatherColor");
+        m_Uniforms.weatherPointSize = glGetUniformLocation(shaderProgram, "weatherPointSize");
+    }
+    glUniform1i(m_Uniforms.wrapVolume, 1);
+    glUniform3fv(m_Uniforms.volumeSize, 1, &m_Size[0]);
+    glUniform3fv(m_Uniforms.volumeShift, 1, &shift[0]);
+    glUniform1f(m_Uniforms.swayPhase, m_SwayPhase);
+    glUniform1f(m_Uniforms.swayAmount, m_SwayAmount);
+    glUniform4fv(m_Uniforms.weatherColor, 1, &m_Color[0]);
+    glUniform1f(m_Uniforms.weatherPointSize, m_PointSize);
+
+    glBindVertexArray(m_VAO);
+    glDrawArrays(GL_POINTS, 0, m_ParticleCount);
+    glBindVertexArray(0);
+
+    // The program is shared with ParticleSystem's CPU path
+    glUniform1i(m_Uniforms.wrapVolume, 0);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
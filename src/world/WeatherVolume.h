@@ -0,0 +1,52 @@
+#pragma once
+#include "ParticleSystem.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// Rain or snow as a fixed set of points in a box that repeats around the camera. Each point
+// only stores a random seed; particle.vert places it from the seed, the box's scroll offset
+// and the camera position, wrapping it back into the box centred on the camera. Per frame the
+// CPU advances one offset and sets a few uniforms, whatever the point count, and nothing is
+// uploaded after construction.
+class WeatherVolume {
+public:
+    WeatherVolume(int particleCount = 20000, const glm::vec3& size = glm::vec3(200.0f, 120.0f, 200.0f),
+                  uint32_t seed = 1);
+    ~WeatherVolume();
+
+    // Rain or Snow; only changes uniforms, the point set is shared
+    void SetType(ParticleType type);
+    void Update(float deltaTime);
+    // Draws with particle.vert's wrapVolume path, which centres the box on FrameData's
+    // followCameraPos; cameraPos must be the same position
+    void Draw(unsigned int shaderProgram, const glm::vec3& cameraPos);
+
+    ParticleType GetType() const { return m_Type; }
+    int GetParticleCount() const { return m_ParticleCount; }
+
+private:
+    ParticleType m_Type = ParticleType::Rain;
+    int m_ParticleCount;
+    glm::vec3 m_Size;
+
+    // Per-type look, set by SetType
+    glm::vec3 m_Velocity;
+    glm::vec4 m_Color;
+    float m_PointSize;
+    float m_SwayAmount;
+
+    // Scroll of the box, kept within [0, m_Size) so it never loses precision
+    glm::vec3 m_Offset = glm::vec3(0.0f);
+    // Sway time, wrapped at 20*pi (see Update)
+    float m_SwayPhase = 0.0f;
+
+    unsigned int m_VAO = 0, m_VBO = 0;
+
+    // Uniform locations in the program last drawn with, looked up again only when it changes
+    struct Uniforms {
+        unsigned int program = 0;
+        GLint wrapVolume = -1, volumeSize = -1, volumeShift = -1, swayPhase = -1, swayAmount = -1;
+        GLint weatherColor = -1, weatherPointSize = -1;
+    } m_Uniforms;
+};
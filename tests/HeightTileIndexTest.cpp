@@ -0,0 +1,72 @@
+// HeightTileIndex must answer a point from the finest resident tile no matter which queries
+// came before it on the same thread. Returns non-zero on the first mismatch.
+#include "world/HeightTileIndex.h"
+#include "world/TerrainNoise.h"
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+namespace {
+
+constexpr int ChunkSize = 16;
+
+std::shared_ptr<const HeightTile> FlatTile(const ChunkKey& key, float height) {
+    auto tile = std::make_shared<HeightTile>();
+    float nodeSize = (float)(ChunkSize << key.level);
+    tile->originX = key.x * nodeSize;
+    tile->originZ = key.z * nodeSize;
+    tile->spacing = (float)(1 << key.level);
+    tile->vertsPerSide = ChunkSize + 1;
+    tile->heights.assign((size_t)tile->vertsPerSide * tile->vertsPerSide, height);
+    return tile;
+}
+
+bool Check(const char* what, float got, float expected) {
+    if (got == expected) return true;
+    std::printf("FAIL %s: got %.8g, expected %.8g\n", what, got, expected);
+    return false;
+}
+
+// Height of (x, z) from a thread that has made no earlier queries
+float FreshHeight(const HeightTileIndex& index, float x, float z) {
+    float height = 0.0f;
+    std::thread([&] { height = index.GetHeight(x, z); }).join();
+    return height;
+}
+
+}
+
+int main() {
+    HeightTileIndex index(ChunkSize, 2);
+    // A level-1 node over [0, 32)^2 and one resident level-0 child over [16, 32) x [0, 16)
+    const float coarseHeight = 10.0f, fineHeight = 5.0f;
+    index.Insert(ChunkKey{0, 0, 1}, FlatTile(ChunkKey{0, 0, 1}, coarseHeight));
+    index.Insert(ChunkKey{1, 0, 0}, FlatTile(ChunkKey{1, 0, 0}, fineHeight));
+    const float coarseX = 4.0f, coarseZ = 4.0f;
+    const float fineX = 20.0f, fineZ = 4.0f;
+    bool ok = true;
+
+    // Coarse query first, then a point the coarse tile also contains but the fine tile covers
+    ok &= Check("GetHeight coarse", index.GetHeight(coarseX, coarseZ), coarseHeight);
+    ok &= Check("GetHeight fine after coarse", index.GetHeight(fineX, fineZ), FreshHeight(index, fineX, fineZ));
+    ok &= Check("GetHeight fine", index.GetHeight(fineX, fineZ), fineHeight);
+    ok &= Check("GetHeight coarse after fine", index.GetHeight(coarseX, coarseZ), FreshHeight(index, coarseX, coarseZ));
+
+    const glm::vec2 positions[] = { {coarseX, coarseZ}, {fineX, fineZ}, {coarseX, coarseZ}, {-8.0f, 4.0f} };
+    float heights[4];
+    index.GetHeights(positions, heights, 4);
+    ok &= Check("GetHeights coarse", heights[0], coarseHeight);
+    ok &= Check("GetHeights fine after coarse", heights[1], fineHeight);
+    ok &= Check("GetHeights coarse after fine", heights[2], coarseHeight);
+    ok &= Check("GetHeights outside tiles", heights[3], TerrainNoise::Fbm(-8.0f, 4.0f));
+
+    // Releasing the fine tile must not leave its height cached
+    index.GetHeight(fineX, fineZ);
+    index.Erase(ChunkKey{1, 0, 0});
+    ok &= Check("GetHeight after erase", index.GetHeight(fineX, fineZ), coarseHeight);
+    ok &= Check("GetTileCount", (float)index.GetTileCount(), 1.0f);
+
+    if (!ok) return 1;
+    std::printf("HeightTileIndex: OK\n");
+    return 0;
+}
@@ -0,0 +1,133 @@
+// ParticleDepthSort against std::sort on the same 16-bit depth keys, its incremental repair after
+// small moves, and SwapRemove keeping the order attached to the surviving particles. Returns
+// non-zero on the first mismatch.
+#include "world/ParticleDepthSort.h"
+#include "core/Random.h"
+#include "core/ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// View matrix row giving view z = world z, so the keys below match the sorter's exactly
+const glm::vec4 DepthRow(0.0f, 0.0f, 1.0f, 0.0f);
+
+bool Check(const char* what, long long got, long long expected) {
+    if (got == expected) return true;
+    std::printf("FAIL %s: got %lld, expected %lld\n", what, got, expected);
+    return false;
+}
+
+struct Particles {
+    std::vector<float> x, y, z;
+    std::vector<int> id;   // follows the particle through swap-removes
+
+    void Add(Pcg32& random, int count) {
+        for (int i = 0; i < count; ++i) {
+            x.push_back(random.NextFloat11() * 100.0f);
+            y.push_back(random.NextFloat11() * 100.0f);
+            z.push_back(random.NextFloat11() * 500.0f);
+            id.push_back((int)id.size());
+        }
+    }
+    int Count() const { return (int)z.size(); }
+    // Same quantization as the sorter: [min, max] of the view depth onto 0..65535
+    std::vector<uint16_t> Keys() const {
+        float lo = *std::min_element(z.begin(), z.end());
+        float hi = *std::max_element(z.begin(), z.end());
+        float scale = (hi > lo) ? 65535.0f / (hi - lo) : 0.0f;
+        std::vector<uint16_t> keys;
+        for (float d : z) keys.push_back((uint16_t)((d - lo) * scale));
+        return keys;
+    }
+};
+
+// order must hold every particle once, farthest (smallest key) first
+bool CheckOrder(const char* what, const std::vector<uint32_t>& order, const Particles& particles) {
+    int count = particles.Count();
+    if (!Check(what, (long long)order.size(), count)) return false;
+    std::vector<uint16_t> keys = particles.Keys();
+    std::vector<char> seen(count, 0);
+    for (int i = 0; i < count; ++i) {
+        if (!Check(what, order[i] < (uint32_t)count && !seen[order[i]], 1)) return false;
+        seen[order[i]] = 1;
+        if (i > 0 && !Check(what, keys[order[i - 1]] <= keys[order[i]], 1)) return false;
+    }
+    return true;
+}
+
+}
+
+int main() {
+    ThreadPool workers(4);
+    Pcg32 random(7, 11);
+    bool ok = true;
+
+    // Radix sort: several blocks, worker pool. With no previous order the sort is stable over
+    // the particle indices, so it must equal std::sort on (key, index)
+    Particles particles;
+    particles.Add(random, 50000);
+    ParticleDepthSort sort;
+    const std::vector<uint32_t>& order = sort.Sort(particles.x.data(), particles.y.data(), particles.z.data(),
+                                                   particles.Count(), DepthRow, &workers);
+    ok &= Check("first Sort is a radix sort", sort.GetStats().incremental, 0);
+    ok &= Check("radix passes", sort.GetStats().radixPasses, 2);
+    std::vector<uint16_t> keys = particles.Keys();
+    std::vector<uint32_t> expected(particles.Count());
+    for (int i = 0; i < particles.Count(); ++i) expected[i] = (uint32_t)i;
+    std::sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) {
+        return keys[a] != keys[b] ? keys[a] < keys[b] : a < b;
+    });
+    ok &= Check("radix order matches std::sort", order == expected, 1);
+
+    // Small moves keep last frame's order nearly sorted: it is repaired, not re-sorted
+    for (int frame = 0; frame < 3; ++frame) {
+        for (int i = 0; i < particles.Count(); i += 97) particles.z[i] += random.NextFloat11() * 0.5f;
+        sort.Sort(particles.x.data(), particles.y.data(), particles.z.data(), particles.Count(), DepthRow, &workers);
+        ok &= Check("small moves repair the order", sort.GetStats().incremental, 1);
+        ok &= CheckOrder("repaired order", sort.GetOrder(), particles);
+    }
+
+    // Swap-removes as the particle pool does them, with particles added since the last Sort:
+    // removed slots inside and beyond the sorted count, filled from either side of it. The new
+    // particles sit at the largest depth already present, so the keys keep their range, the
+    // order stays repairable and must be repaired
+    int sorted = particles.Count();
+    float nearest = *std::max_element(particles.z.begin(), particles.z.end());
+    particles.Add(random, 100);
+    for (int i = sorted; i < particles.Count(); ++i) particles.z[i] = nearest;
+    std::vector<int> sortedIds;
+    for (uint32_t index : sort.GetOrder()) sortedIds.push_back(particles.id[index]);
+    std::vector<char> removedId(particles.Count(), 0);
+    const int removals[] = { 10, sorted + 5, sorted - 1, 20, sorted + 50, 30 };
+    for (int index : removals) {
+        int last = particles.Count() - 1;
+        removedId[particles.id[index]] = 1;
+        particles.x[index] = particles.x[last];
+        particles.y[index] = particles.y[last];
+        particles.z[index] = particles.z[last];
+        particles.id[index] = particles.id[last];
+        particles.x.pop_back();
+        particles.y.pop_back();
+        particles.z.pop_back();
+        particles.id.pop_back();
+        sort.SwapRemove(index, last);
+    }
+    // Every entry the order still holds points at the particle it was sorted as
+    int kept = 0;
+    for (size_t i = 0; i < sort.GetOrder().size(); ++i) {
+        uint32_t index = sort.GetOrder()[i];
+        if (removedId[sortedIds[i]]) continue;
+        ok &= Check("order follows swap-removed particles", particles.id[index], sortedIds[i]);
+        ++kept;
+    }
+    ok &= Check("sorted particles kept", kept, sorted - 4);
+    sort.Sort(particles.x.data(), particles.y.data(), particles.z.data(), particles.Count(), DepthRow, &workers);
+    ok &= Check("repair after swap-removes", sort.GetStats().incremental, 1);
+    ok &= CheckOrder("order after swap-removes", sort.GetOrder(), particles);
+
+    if (!ok) return 1;
+    std::printf("ParticleDepthSort: OK\n");
+    return 0;
+}
@@ -0,0 +1,78 @@
+// A full ParticlePool must overwrite its oldest particles first, across frames, and keep every
+// live particle when the policy drops new ones. Each particle's posX holds its emission number.
+// Returns non-zero on the first mismatch.
+#include "world/ParticlePool.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr int Capacity = 8;
+
+bool Check(const char* what, int got, int expected) {
+    if (got == expected) return true;
+    std::printf("FAIL %s: got %d, expected %d\n", what, got, expected);
+    return false;
+}
+
+// Claims one slot and stamps it with serial; returns whether a live particle was overwritten
+bool Emit(ParticlePool& pool, int serial, bool& ok) {
+    bool recycled = false;
+    int idx = pool.Claim(recycled);
+    if (idx < 0) return false;
+    pool.posX[idx] = (float)serial;
+    pool.life[idx] = 100.0f;
+    pool.size[idx] = 1.0f;
+    ok &= Check("claimed slot in live range", idx < pool.GetAliveCount(), 1);
+    return recycled;
+}
+
+// The live particles must be exactly serials [first, first + count)
+bool CheckSurvivors(const char* what, const ParticlePool& pool, int first, int count) {
+    std::vector<int> serials;
+    for (int i = 0; i < pool.GetAliveCount(); ++i) serials.push_back((int)pool.posX[i]);
+    std::sort(serials.begin(), serials.end());
+    bool ok = Check(what, (int)serials.size(), count);
+    for (int i = 0; ok && i < count; ++i) ok &= Check(what, serials[i], first + i);
+    return ok;
+}
+
+}
+
+int main() {
+    bool ok = true;
+
+    // Recycle: a few new particles per frame into a saturated pool; the pool removes dead
+    // particles every frame (none here), which must not restart the recycling
+    ParticlePool pool(Capacity);
+    int serial = 0;
+    for (; serial < Capacity; ++serial) ok &= Check("fill does not recycle", Emit(pool, serial, ok), 0);
+    for (int frame = 0; frame < 5; ++frame) {
+        pool.RemoveDead(nullptr);
+        for (int i = 0; i < 3; ++i, ++serial) ok &= Check("saturated pool recycles", Emit(pool, serial, ok), 1);
+    }
+    ok &= CheckSurvivors("newest particles survive", pool, serial - Capacity, Capacity);
+
+    // Dead particles free their slots, which are used before anything live is recycled
+    for (int i = 0; i < pool.GetAliveCount(); ++i) {
+        if ((int)pool.posX[i] < serial - Capacity + 3) pool.life[i] = 0.0f;
+    }
+    pool.RemoveDead(nullptr);
+    ok &= Check("alive after removal", pool.GetAliveCount(), Capacity - 3);
+    for (int i = 0; i < 3; ++i, ++serial) ok &= Check("free slots before recycling", Emit(pool, serial, ok), 0);
+    ok &= CheckSurvivors("survivors after refill", pool, serial - Capacity, Capacity);
+
+    // DropNew: the full pool keeps what it has
+    ParticlePool dropping(Capacity);
+    dropping.SetOverflowPolicy(ParticleOverflow::DropNew);
+    for (int i = 0; i < Capacity; ++i) Emit(dropping, i, ok);
+    bool recycled = true;
+    ok &= Check("DropNew claim", dropping.Claim(recycled), -1);
+    ok &= Check("DropNew recycled", recycled, 0);
+    ok &= CheckSurvivors("DropNew keeps the oldest", dropping, 0, Capacity);
+
+    if (!ok) return 1;
+    std::printf("ParticlePool: OK\n");
+    return 0;
+}
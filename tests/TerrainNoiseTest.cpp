@@ -0,0 +1,86 @@
+// FbmGrid / FbmGridDerivatives against the scalar Fbm / FbmDerivatives, at every SIMD level this
+// CPU supports and for both noise backends. Returns non-zero on the first mismatch.
+#include "world/TerrainNoise.h"
+#include "core/Random.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+struct Tile {
+    float x0, z0, step;
+    int width, height;
+};
+
+bool CheckClose(const char* what, float grid, float scalar, const Tile& tile, int col, int row) {
+    if (std::fabs(grid - scalar) <= TerrainNoise::FbmGridTolerance) return true;
+    std::printf("FAIL %s at (%d, %d) of tile x0=%g z0=%g step=%g %dx%d: grid %.8g, scalar %.8g\n",
+                what, col, row, tile.x0, tile.z0, tile.step, tile.width, tile.height, grid, scalar);
+    return false;
+}
+
+bool CheckTile(const Tile& tile) {
+    size_t count = (size_t)tile.width * tile.height;
+    std::vector<float> heights(count), gridHeights(count), dx(count), dz(count);
+    TerrainNoise::FbmGrid(tile.x0, tile.z0, tile.step, tile.width, tile.height, heights.data());
+    TerrainNoise::FbmGridDerivatives(tile.x0, tile.z0, tile.step, tile.width, tile.height,
+                                     gridHeights.data(), dx.data(), dz.data());
+    for (int row = 0; row < tile.height; ++row) {
+        for (int col = 0; col < tile.width; ++col) {
+            size_t i = (size_t)row * tile.width + col;
+            float x = tile.x0 + col * tile.step;
+            float z = tile.z0 + row * tile.step;
+            float scalarDx, scalarDz;
+            float scalar = TerrainNoise::FbmDerivatives(x, z, &scalarDx, &scalarDz);
+            if (!CheckClose("FbmGrid", heights[i], TerrainNoise::Fbm(x, z), tile, col, row) ||
+                !CheckClose("FbmGridDerivatives height", gridHeights[i], scalar, tile, col, row) ||
+                !CheckClose("FbmGridDerivatives dH/dx", dx[i], scalarDx, tile, col, row) ||
+                !CheckClose("FbmGridDerivatives dH/dz", dz[i], scalarDz, tile, col, row)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}
+
+int main() {
+    using TerrainNoise::SimdLevel;
+    using TerrainNoise::NoiseBackend;
+    const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+    const NoiseBackend backends[] = { NoiseBackend::Legacy, NoiseBackend::IntegerHash };
+    const float steps[] = { 0.25f, 1.0f, 2.0f, 4.0f, 16.0f, 0.7f };
+    int tilesChecked = 0;
+
+    for (NoiseBackend backend : backends) {
+        TerrainNoise::SetBackend(backend, 1337);
+        for (SimdLevel level : levels) {
+            TerrainNoise::SetSimdLevel(level);
+            if (TerrainNoise::GetSimdLevel() != level) {
+                std::printf("skip %s: not supported on this CPU\n", TerrainNoise::GetSimdLevelName(level));
+                continue;
+            }
+            Pcg32 random(42, (uint64_t)level);
+            for (int i = 0; i < 200; ++i) {
+                Tile tile;
+                // Origins up to +-20000 units (the legacy hash loses precision far beyond that)
+                tile.x0 = random.NextFloat11() * 20000.0f;
+                tile.z0 = random.NextFloat11() * 20000.0f;
+                tile.step = steps[random.NextU32() % (sizeof(steps) / sizeof(steps[0]))];
+                // 1..40 wide, so most rows end in a partial vector for SSE2 (4) and AVX2 (8)
+                tile.width = 1 + (int)(random.NextU32() % 40);
+                tile.height = 1 + (int)(random.NextU32() % 12);
+                if (!CheckTile(tile)) {
+                    std::printf("backend %s, level %s\n", TerrainNoise::GetBackendName(backend),
+                                TerrainNoise::GetSimdLevelName(level));
+                    return 1;
+                }
+                tilesChecked++;
+            }
+        }
+    }
+    std::printf("OK: %d tiles match scalar Fbm within %g\n", tilesChecked, TerrainNoise::FbmGridTolerance);
+    return 0;
+}
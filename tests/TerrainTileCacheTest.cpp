@@ -0,0 +1,87 @@
+// TerrainTileCache must evict the least recently used tile once full, and keep both its tiles
+// and their recency across closing and reopening the file. Returns non-zero on the first mismatch.
+#include "world/TerrainTileCache.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+const char* CachePath = "TerrainTileCacheTest.bin";
+constexpr int VertsPerSide = 5;
+constexpr int VertexCount = VertsPerSide * VertsPerSide;
+constexpr int Capacity = 3;
+
+// Room for exactly Capacity tiles: a header of at most 64 bytes, then a 40-byte entry and a
+// record per tile
+size_t CacheBytes() {
+    size_t recordBytes = (2 * sizeof(float) + VertexCount * sizeof(uint16_t) + VertexCount * 2 * sizeof(int16_t) + 7) & ~(size_t)7;
+    return 64 + Capacity * (recordBytes + 40);
+}
+
+bool Check(const char* what, long long got, long long expected) {
+    if (got == expected) return true;
+    std::printf("FAIL %s: got %lld, expected %lld\n", what, got, expected);
+    return false;
+}
+
+// Each tile gets distinct contents derived from its x
+void Store(TerrainTileCache& cache, int x) {
+    std::vector<float> heights(VertexCount);
+    std::vector<int16_t> normals(VertexCount * 2);
+    for (int i = 0; i < VertexCount; ++i) heights[i] = x * 10.0f + i * 0.5f;
+    for (int i = 0; i < VertexCount * 2; ++i) normals[i] = (int16_t)(x * 100 + i);
+    cache.Store(ChunkKey{x, 0, 0}, heights.data(), normals.data());
+}
+
+// Whether tile x is cached, checking its contents when it is
+bool Load(TerrainTileCache& cache, int x, bool& ok) {
+    std::vector<float> heights(VertexCount);
+    std::vector<int16_t> normals(VertexCount * 2);
+    if (!cache.Load(ChunkKey{x, 0, 0}, heights.data(), normals.data())) return false;
+    // Heights are quantized to 16 bits over the tile's range
+    float tolerance = VertexCount * 0.5f / 65535.0f;
+    for (int i = 0; i < VertexCount; ++i) ok &= Check("height", std::fabs(heights[i] - (x * 10.0f + i * 0.5f)) <= tolerance, 1);
+    for (int i = 0; i < VertexCount * 2; ++i) ok &= Check("normal", normals[i], x * 100 + i);
+    return true;
+}
+
+}
+
+int main() {
+    std::remove(CachePath);
+    bool ok = true;
+    {
+        TerrainTileCache cache(CachePath, CacheBytes(), VertsPerSide, 1, 2);
+        ok &= Check("open", cache.IsOpen(), 1);
+        for (int x = 0; x < Capacity; ++x) Store(cache, x);
+        // A hit makes tile 0 recent, so tile 1 is the least recently used
+        ok &= Check("hit 0", Load(cache, 0, ok), 1);
+        Store(cache, 3);
+        ok &= Check("evictions", (long long)cache.GetStats().evictions, 1);
+        ok &= Check("least recently used evicted", Load(cache, 1, ok), 0);
+        ok &= Check("hit 0 after eviction", Load(cache, 0, ok), 1);
+        ok &= Check("hit 3", Load(cache, 3, ok), 1);
+        // Recency is now 2, 3, 0 from newest: tile 0 goes next
+        ok &= Check("hit 2", Load(cache, 2, ok), 1);
+    }
+    {
+        TerrainTileCache cache(CachePath, CacheBytes(), VertsPerSide, 1, 2);
+        ok &= Check("tiles after reopen", (long long)cache.GetTileCount(), Capacity);
+        Store(cache, 4);
+        ok &= Check("least recently used before close evicted", Load(cache, 0, ok), 0);
+        ok &= Check("hit 2 after reopen", Load(cache, 2, ok), 1);
+        ok &= Check("hit 3 after reopen", Load(cache, 3, ok), 1);
+        ok &= Check("hit 4", Load(cache, 4, ok), 1);
+    }
+    // Another seed shares the file but never sees these tiles
+    {
+        TerrainTileCache cache(CachePath, CacheBytes(), VertsPerSide, 9, 2);
+        ok &= Check("other seed misses", Load(cache, 2, ok), 0);
+    }
+    std::remove(CachePath);
+
+    if (!ok) return 1;
+    std::printf("TerrainTileCache: OK\n");
+    return 0;
+}